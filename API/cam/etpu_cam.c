@@ -10,9 +10,9 @@
 *
 * @author  Milan Brejl [r54529]
 *
-* @version 1.0
+* @version 1.2
 *
-* @date    16-Mar-2014
+* @date    18-Oct-2026
 *
 * @brief   This file contains API for using the eTPU function
 *          Cam (CAM).
@@ -38,6 +38,8 @@
 * - Number of transitions logged during the last engine cycle (between last
 *   two log resets) and the actual position in the log buffer are available
 *   to read.
+* - The log can be read incrementally - only the items logged since the last
+*   read are copied, see @ref fs_etpu_cam_copy_log_new.
 * - 2 error conditions are reported:
 *   - @ref FS_ETPU_CAM_ERROR_ZERO_TRANS – no input transition was logged during
 *     the last engine cycle (between last two leg resets).
@@ -95,12 +97,17 @@ uint32_t fs_etpu_cam_init(
   uint8_t  log_size;
   uint32_t *cpba_log;
   uint32_t *cpba;
+  uint32_t *cpba_windows;
+  uint8_t  window_count;
+  struct cam_window_config_t *p_cam_window_config;
+  uint8_t  i;
 
   chan_num = p_cam_instance->chan_num;
   priority = p_cam_instance->priority;
   log_size = p_cam_instance->log_size;
   cpba_log = p_cam_instance->cpba_log;
   cpba     = p_cam_instance->cpba;
+  cpba_windows = p_cam_instance->cpba_windows;
 
   /* Use user-defined CPBA or allocate new eTPU DATA RAM */
   if(cpba == 0)
@@ -130,6 +137,23 @@ uint32_t fs_etpu_cam_init(
     }
   }
 
+  /* Use user-defined CPBA or allocate new eTPU DATA RAM for CAM windows */
+  window_count = p_cam_config->window_count;
+  if((cpba_windows == 0) && (window_count > 0))
+  {
+    cpba_windows =
+      fs_etpu_malloc(FS_ETPU_CAM_WINDOW_STRUCT_SIZE * window_count);
+    if(cpba_windows == 0)
+    {
+      return(FS_ETPU_ERROR_MALLOC);
+    }
+    else
+    {
+      p_cam_instance->cpba_windows = cpba_windows;
+    }
+  }
+  p_cam_instance->window_count_max = window_count;
+
   /* Write chan config registers and FM bits */
   eTPU->CHAN[chan_num].CR.R =
        (FS_ETPU_CAM_TABLE_SELECT << 24) +
@@ -142,7 +166,30 @@ uint32_t fs_etpu_cam_init(
   *(cpba + ((FS_ETPU_CAM_OFFSET_LOG_IDX   - 1)>>2)) = 0;
   *(cpba + ((FS_ETPU_CAM_OFFSET_LOG_COUNT - 1)>>2)) = 0;
   *(cpba + ((FS_ETPU_CAM_OFFSET_LOG       - 1)>>2)) = (uint32_t)cpba_log - fs_etpu_data_ram_start;
+  if(cpba_windows == 0)
+  {
+    *(cpba + ((FS_ETPU_CAM_OFFSET_WINDOW  - 1)>>2)) = 0;
+  }
+  else
+  {
+    *(cpba + ((FS_ETPU_CAM_OFFSET_WINDOW  - 1)>>2)) = (uint32_t)cpba_windows - fs_etpu_data_ram_start;
+  }
   *((uint8_t*)cpba + FS_ETPU_CAM_OFFSET_ERROR     ) = FS_ETPU_CAM_ERROR_NO;
+  *((uint8_t*)cpba + FS_ETPU_CAM_OFFSET_RESET_COUNT) = 0;
+  *((uint8_t*)cpba + FS_ETPU_CAM_OFFSET_WINDOW_COUNT) = window_count;
+
+  /* Write array of CAM window parameters */
+  p_cam_window_config = p_cam_config->p_cam_window_config;
+  for(i=0; i<window_count; i++)
+  {
+    /* 24-bit first, then the 8-bit transition in bits 31:24 */
+    *(cpba_windows + ((FS_ETPU_CAM_WINDOW_OFFSET_START - 1)>>2)) = p_cam_window_config->angle_start;
+    *(cpba_windows + ((FS_ETPU_CAM_WINDOW_OFFSET_WIDTH - 1)>>2)) = p_cam_window_config->angle_width;
+    *((uint8_t*)cpba_windows + FS_ETPU_CAM_WINDOW_OFFSET_TRANS) = p_cam_window_config->trans;
+
+    p_cam_window_config++;
+    cpba_windows += FS_ETPU_CAM_WINDOW_STRUCT_SIZE >> 2;
+  }
 
   /* Write HSR */
   eTPU->CHAN[chan_num].HSRR.R = FS_ETPU_CAM_HSR_INIT;
@@ -160,6 +207,12 @@ uint32_t fs_etpu_cam_init(
 *
 * @note    The following actions are performed in order:
 *          -# Write FM bits
+*          -# Write configuration parameter values to eTPU DATA RAM
+*
+*          The CAM windows are compared with the windows in eTPU DATA RAM
+*          and rewritten only if they differ. While they are rewritten,
+*          the window_count in eTPU DATA RAM is 0, so that the eTPU does not
+*          check the Cam log against a partially updated array of windows.
 *
 * @param   *p_cam_instance - This is a pointer to the instance structure
 *            @ref cam_instance_t.
@@ -167,6 +220,8 @@ uint32_t fs_etpu_cam_init(
 *            parameters @ref cam_config_t.
 *
 * @return  Error codes that can be returned are:
+*          - @ref FS_ETPU_ERROR_VALUE - window_count is higher than the
+*            window_count_max allocated on initialization
 *          - @ref FS_ETPU_ERROR_NONE - No error
 *
 *******************************************************************************/
@@ -174,9 +229,62 @@ uint32_t fs_etpu_cam_config(
   struct cam_instance_t *p_cam_instance,
   struct cam_config_t   *p_cam_config)
 {
+  uint32_t *cpba;
+  uint32_t *cpba_windows;
+  struct cam_window_config_t *p_cam_window_config;
+  uint8_t  window_count;
+  uint8_t  changed;
+  uint8_t  i;
+
+  cpba         = p_cam_instance->cpba;
+  cpba_windows = p_cam_instance->cpba_windows;
+  window_count = p_cam_config->window_count;
+
+  /* Check the windows fit into the allocated array */
+  if(window_count > p_cam_instance->window_count_max)
+  {
+    return(FS_ETPU_ERROR_VALUE);
+  }
+
   /* Write FM bits */
   eTPU->CHAN[p_cam_instance->chan_num].SCR.R = (uint32_t)p_cam_config->mode;
 
+  /* Compare array of CAM window parameters, 24-bit in bits 23:0 */
+  changed = (*((uint8_t*)cpba + FS_ETPU_CAM_OFFSET_WINDOW_COUNT) != window_count);
+  p_cam_window_config = p_cam_config->p_cam_window_config;
+  for(i=0; (i<window_count) && !changed; i++)
+  {
+    changed =
+      ((0x00FFFFFF & *(cpba_windows + ((FS_ETPU_CAM_WINDOW_OFFSET_START - 1)>>2))) != p_cam_window_config->angle_start)
+   || ((0x00FFFFFF & *(cpba_windows + ((FS_ETPU_CAM_WINDOW_OFFSET_WIDTH - 1)>>2))) != p_cam_window_config->angle_width)
+   || (*((uint8_t*)cpba_windows + FS_ETPU_CAM_WINDOW_OFFSET_TRANS) != p_cam_window_config->trans);
+
+    p_cam_window_config++;
+    cpba_windows += FS_ETPU_CAM_WINDOW_STRUCT_SIZE >> 2;
+  }
+
+  if(changed)
+  {
+    /* 8-bit - disable the phase check while the windows are rewritten */
+    *((uint8_t*)cpba + FS_ETPU_CAM_OFFSET_WINDOW_COUNT) = 0;
+
+    /* Write array of CAM window parameters */
+    cpba_windows = p_cam_instance->cpba_windows;
+    p_cam_window_config = p_cam_config->p_cam_window_config;
+    for(i=0; i<window_count; i++)
+    {
+      /* 24-bit first, then the 8-bit transition in bits 31:24 */
+      *(cpba_windows + ((FS_ETPU_CAM_WINDOW_OFFSET_START - 1)>>2)) = p_cam_window_config->angle_start;
+      *(cpba_windows + ((FS_ETPU_CAM_WINDOW_OFFSET_WIDTH - 1)>>2)) = p_cam_window_config->angle_width;
+      *((uint8_t*)cpba_windows + FS_ETPU_CAM_WINDOW_OFFSET_TRANS) = p_cam_window_config->trans;
+
+      p_cam_window_config++;
+      cpba_windows += FS_ETPU_CAM_WINDOW_STRUCT_SIZE >> 2;
+    }
+    /* 8-bit */
+    *((uint8_t*)cpba + FS_ETPU_CAM_OFFSET_WINDOW_COUNT) = window_count;
+  }
+
   return(FS_ETPU_ERROR_NONE);
 }
 
@@ -257,6 +365,95 @@ uint32_t *fs_etpu_cam_copy_log(
   return(dest);
 }
 
+/*******************************************************************************
+* FUNCTION: fs_etpu_cam_copy_log_new
+****************************************************************************//*!
+* @brief   This function copies only the CAM log items logged since the last
+*          call into another array in RAM.
+*
+* @note    The following actions are performed in order:
+*          -# Read reset_count, log_count and log_idx from eTPU DATA RAM,
+*             repeat if the log was reset in between.
+*          -# If the log was reset once since the last read, copy the items
+*             of the previous log cycle which were not read yet and are not
+*             overwritten yet.
+*          -# Copy the items between the last read index and log_idx.
+*          -# Store the reset_count and log_idx to *p_cam_log_read.
+*
+*          The items are copied to the same positions in p_cam_log as they have
+*          in the eTPU log buffer, so that p_cam_log is a copy of the eTPU log.
+*          Unlike @ref fs_etpu_cam_copy_log, the amount of eTPU DATA RAM read
+*          corresponds to the number of new transitions, not to log_size.
+*
+* @param   *p_cam_instance - This is a pointer to the instance structure
+*            @ref cam_instance_t.
+* @param   *p_cam_log_read - This is a pointer to the structure of the last
+*            read position @ref cam_log_read_t. It must be cleared to zeros
+*            whenever the CAM is initialized.
+* @param   *p_cam_log - This is a pointer where the Cam log will be copied to.
+*            The array must have p_cam_instance->log_size items.
+*
+* @return  The number of log items copied.
+*
+*******************************************************************************/
+uint32_t fs_etpu_cam_copy_log_new(
+  struct cam_instance_t *p_cam_instance,
+  struct cam_log_read_t *p_cam_log_read,
+               uint32_t *p_cam_log)
+{
+  uint32_t *cpba;
+  uint32_t *cpba_log;
+  uint8_t  reset_count;
+  uint8_t  log_count;
+  uint8_t  log_idx;
+  uint8_t  i;
+  uint32_t count = 0;
+
+  cpba     = p_cam_instance->cpba;
+  cpba_log = p_cam_instance->cpba_log;
+
+  /* Read log position, repeat if the log was reset in between */
+  do
+  {
+    reset_count = *((uint8_t*)cpba + FS_ETPU_CAM_OFFSET_RESET_COUNT);
+    log_count   = (uint8_t)*(cpba + ((FS_ETPU_CAM_OFFSET_LOG_COUNT - 1)>>2));
+    log_idx     = (uint8_t)*(cpba + ((FS_ETPU_CAM_OFFSET_LOG_IDX   - 1)>>2));
+  }
+  while(reset_count != *((uint8_t*)cpba + FS_ETPU_CAM_OFFSET_RESET_COUNT));
+
+  i = p_cam_log_read->log_idx;
+  if(reset_count != p_cam_log_read->reset_count)
+  {
+    if((uint8_t)(reset_count - p_cam_log_read->reset_count) == 1)
+    {
+      /* Copy the rest of the previous log cycle, skipping the items already
+         overwritten by the current log cycle */
+      if(i < log_idx)
+      {
+        i = log_idx;
+      }
+      for(; i < log_count; i++)
+      {
+        p_cam_log[i] = cpba_log[i];
+        count++;
+      }
+    }
+    i = 0;
+  }
+
+  /* Copy the new items of the current log cycle */
+  for(; i < log_idx; i++)
+  {
+    p_cam_log[i] = cpba_log[i];
+    count++;
+  }
+
+  p_cam_log_read->reset_count = reset_count;
+  p_cam_log_read->log_idx     = log_idx;
+
+  return(count);
+}
+
 /*******************************************************************************
 * FUNCTION: fs_etpu_cam_reset_log
 ****************************************************************************//*!
@@ -336,6 +533,14 @@ uint32_t fs_etpu_cam_reset_log(
  *
  * FILE OWNER: Milan Brejl [r54529]
  *
+ * Revision 1.2  2026/10/18
+ * window_count_max stored on init, fs_etpu_cam_config() checks it and
+ * rewrites the CAM windows only when they change.
+ *
+ * Revision 1.1  2026/10/18
+ * CAM windows added to check the engine phase in full sync.
+ * fs_etpu_cam_copy_log_new() added for incremental log reads.
+ *
  * Revision 1.0  2014/03/16  r54529
  * Minor comment and formating improvements.
  * Ready for eTPU Engine Control Library release 1.0.
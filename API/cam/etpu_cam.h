@@ -10,9 +10,9 @@
 *
 * @author  Milan Brejl [r54529]
 *
-* @version 1.0
+* @version 1.2
 *
-* @date    16-Mar-2014
+* @date    18-Oct-2026
 *
 * @brief   This file contains useful macros and prototypes for CAM API.
 *
@@ -54,6 +54,15 @@ struct cam_instance_t
     Set cpba_log = 0 to use automatic allocation of eTPU DATA RAM for the CAM
     buffer using the eTPU utility function fs_etpu_malloc (recommanded), or
     assign the cpba_log manually by an address where the CAM buffer will start.*/
+        uint32_t *cpba_windows; /**< Base address of the CAM windows array in
+    eTPU DATA RAM. Set cpba_windows = 0 to use automatic allocation of the
+    eTPU DATA RAM space corresponding to the window_count value,
+    using the eTPU utility function fs_etpu_malloc (recommanded),
+    or assign the cpba_windows manually by an address, e.g. 0xC3FC8100. */
+        uint8_t  window_count_max; /**< The capacity of the CAM windows
+    array as a number of windows. It is set by fs_etpu_cam_init to the
+    window_count provided on initialization. fs_etpu_cam_config returns
+    FS_ETPU_ERROR_VALUE if a higher window_count is requested. */
 };
 
 /** A structure to represent a configuration of CAM.
@@ -66,6 +75,31 @@ struct cam_config_t
     - @ref FS_ETPU_CAM_LOG_FALLING
     - @ref FS_ETPU_CAM_LOG_RISING
     - @ref FS_ETPU_CAM_LOG_BOTH */
+        uint8_t  window_count;  /**< The count of CAM windows - the count of
+    transitions expected in an engine cycle. Set window_count = 0 to disable
+    the phase check. */
+  struct cam_window_config_t *p_cam_window_config; /**< Pointer to the first
+    item of an array of the CAM window configuration structures. */
+};
+
+/** A structure to represent a single CAM window configuration.
+ *  In full sync, the CAM log of each engine cycle is checked against the array
+ *  of windows, sorted by angle. The count of logged transitions must equal
+ *  window_count, the first logged transition must fit one of the windows and
+ *  each next transition the next window (cyclically). A transition fits a
+ *  window when it has the window polarity and lies within the window angle
+ *  range. Otherwise FS_ETPU_CAM_ERROR_PHASE is set and the CAM channel
+ *  interrupt is raised. */
+struct cam_window_config_t
+{
+        uint8_t  trans;  /**< The expected transition polarity. It can be one of:
+    - @ref FS_ETPU_CAM_WINDOW_FALLING
+    - @ref FS_ETPU_CAM_WINDOW_RISING */
+        uint24_t angle_start;  /**< The window start angle as a number of TCR2
+    ticks, relative to the engine cycle start (the same reference as the
+    tdc_angle of SPARK, FUEL, INJ and KNOCK). The window must not span the
+    engine cycle start. */
+        uint24_t angle_width;  /**< The window width as a number of TCR2 ticks. */
 };
 
 /** A structure to represent internal states of CAM. */
@@ -75,6 +109,7 @@ struct cam_states_t
     the following error flags:
     - @ref FS_ETPU_CAM_ERROR_ZERO_TRANS
     - @ref FS_ETPU_CAM_ERROR_LOG_OVERFLOW
+    - @ref FS_ETPU_CAM_ERROR_PHASE
     The eTPU sets the error flags, the CPU clears them after reading. */
         uint8_t log_count; /**< This is a count of transitions logged during
     the last completed engine cycle. */
@@ -83,6 +118,15 @@ struct cam_states_t
     resetting. */
 };
 
+/** A structure to represent the position of the last incremental read of the
+ *  CAM log, see fs_etpu_cam_copy_log_new. */
+struct cam_log_read_t
+{
+        uint8_t reset_count; /**< The count of CAM log resets at the last read.*/
+        uint8_t log_idx;     /**< The log_idx at the last read - the index of
+    the first log item not read yet. */
+};
+
 /*******************************************************************************
 * Function prototypes
 *******************************************************************************/
@@ -106,6 +150,12 @@ uint32_t *fs_etpu_cam_copy_log(
   struct cam_instance_t *p_cam_instance,
                uint32_t *p_cam_log);
 
+/* Copy new log items */
+uint32_t fs_etpu_cam_copy_log_new(
+  struct cam_instance_t *p_cam_instance,
+  struct cam_log_read_t *p_cam_log_read,
+               uint32_t *p_cam_log);
+
 /* Reset log */
 uint32_t fs_etpu_cam_reset_log(
   struct cam_instance_t *p_cam_instance);
@@ -147,6 +197,13 @@ uint32_t fs_etpu_cam_reset_log(
  *
  * FILE OWNER: Milan Brejl [r54529]
  *
+ * Revision 1.2  2026/10/18
+ * cam_instance_t.window_count_max added.
+ *
+ * Revision 1.1  2026/10/18
+ * CAM windows added to check the engine phase in full sync.
+ * struct cam_log_read_t and fs_etpu_cam_copy_log_new() added.
+ *
  * Revision 1.0  2014/03/16  r54529
  * Minor comment and formating improvements.
  * Ready for eTPU Engine Control Library release 1.0.
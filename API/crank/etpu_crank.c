@@ -52,6 +52,9 @@
 *   achieved using tooth windows (@ref win_ratio_normal,
 *   @ref win_ratio_across_gap, @ref win_ratio_after_gap,
 *   @ref win_ratio_after_timeout)
+* - A stall can be predicted from the deceleration trend of the tooth periods
+*   (@ref stall_decel_ratio, @ref stall_decel_teeth), so that the angle-based
+*   outputs are stopped before the stretched tooth windows close.
 * - The measured tooth periods can optionally be logged to an array.
 * - The CRANK state and the global engine position state are handled.
 *   The CRANK state can be one of:
@@ -140,6 +143,8 @@ extern uint32_t fs_etpu_data_ram_ext;
 *
 * @return  Error codes that can be returned are:
 *          - @ref FS_ETPU_ERROR_MALLOC - eTPU DATA RAM memory allocation error
+*          - @ref FS_ETPU_ERROR_VALUE - stall_decel_ratio is not lower than
+*            win_ratio_normal
 *          - @ref FS_ETPU_ERROR_NONE - No error
 *
 * @warning This function does not configure the pins, only the eTPU channels.
@@ -151,14 +156,24 @@ uint32_t fs_etpu_crank_init(
   uint8_t  chan_num;
   uint8_t  priority;
   uint32_t *cpba_log;
+  uint32_t *cpba_link_extra;
   uint32_t *cpba;
   uint16_t misscnt_mask;
+  uint8_t  i;
 
   chan_num = p_crank_instance->chan_num;
   priority = p_crank_instance->priority;
   cpba_log = p_crank_instance->cpba_tooth_period_log;
+  cpba_link_extra = p_crank_instance->cpba_link_extra;
   cpba     = p_crank_instance->cpba;
 
+  /* Check a decelerating tooth can be accepted in the normal window */
+  if((p_crank_config->stall_decel_teeth != 0) &&
+     (p_crank_config->stall_decel_ratio >= p_crank_config->win_ratio_normal))
+  {
+    return(FS_ETPU_ERROR_VALUE);
+  }
+
   /* Use user-defined CPBA or allocate new eTPU DATA RAM */
   if(cpba == 0)
   {
@@ -189,6 +204,20 @@ uint32_t fs_etpu_crank_init(
     }
   }
 
+  /* Use user-defined additional link array or allocate new eTPU DATA RAM */
+  if(cpba_link_extra == 0 && p_crank_instance->link_extra_count > 0)
+  {
+    cpba_link_extra = fs_etpu_malloc(p_crank_instance->link_extra_count<<2);
+    if(cpba_link_extra == 0)
+    {
+      return(FS_ETPU_ERROR_MALLOC);
+    }
+    else
+    {
+      p_crank_instance->cpba_link_extra = cpba_link_extra;
+    }
+  }
+
   /* Write chan config registers and FM bits */
   eTPU->CHAN[chan_num].CR.R =
        (FS_ETPU_CRANK_TABLE_SELECT << 24) +
@@ -211,7 +240,16 @@ uint32_t fs_etpu_crank_init(
   *(cpba + ((FS_ETPU_CRANK_OFFSET_WIN_RATIO_AFTER_GAP     - 1)>>2)) = p_crank_config->win_ratio_after_gap;
   *(cpba + ((FS_ETPU_CRANK_OFFSET_WIN_RATIO_AFTER_TIMEOUT - 1)>>2)) = p_crank_config->win_ratio_after_timeout;
   *(cpba + ((FS_ETPU_CRANK_OFFSET_FIRST_TOOTH_TIMEOUT     - 1)>>2)) = p_crank_config->first_tooth_timeout;
+  *(cpba + ((FS_ETPU_CRANK_OFFSET_STALL_DECEL_RATIO       - 1)>>2)) = p_crank_config->stall_decel_ratio;
   *(cpba + ((FS_ETPU_CRANK_OFFSET_TOOTH_PERIOD_LOG        - 1)>>2)) = (uint32_t)cpba_log - fs_etpu_data_ram_start;
+  if(cpba_link_extra == 0)
+  {
+    *(cpba + ((FS_ETPU_CRANK_OFFSET_LINK_EXTRA            - 1)>>2)) = 0;
+  }
+  else
+  {
+    *(cpba + ((FS_ETPU_CRANK_OFFSET_LINK_EXTRA            - 1)>>2)) = (uint32_t)cpba_link_extra - fs_etpu_data_ram_start;
+  }
   /* 8-bit */
   *((uint8_t*)cpba + FS_ETPU_CRANK_OFFSET_TCR1_CLOCK_SOURCE_DIV1) = (p_crank_instance->tcr1_clock_source == FS_ETPU_TCR1CS_DIV1);
   *((uint8_t*)cpba + FS_ETPU_CRANK_OFFSET_TEETH_TILL_GAP     ) = p_crank_instance->teeth_till_gap;
@@ -223,6 +261,10 @@ uint32_t fs_etpu_crank_init(
   *((uint8_t*)cpba + FS_ETPU_CRANK_OFFSET_BLANK_TEETH        ) = p_crank_config->blank_teeth;
   *((uint8_t*)cpba + FS_ETPU_CRANK_OFFSET_STATE              ) = FS_ETPU_CRANK_SEEK;
   *((uint8_t*)cpba + FS_ETPU_CRANK_OFFSET_ERROR              ) = FS_ETPU_CRANK_ERR_NO_ERROR;
+  *((uint8_t*)cpba + FS_ETPU_CRANK_OFFSET_LINK_EXTRA_COUNT   ) = p_crank_instance->link_extra_count;
+  *((uint8_t*)cpba + FS_ETPU_CRANK_OFFSET_STALL_DECEL_TEETH  ) = p_crank_config->stall_decel_teeth;
+  *((uint8_t*)cpba + FS_ETPU_CRANK_OFFSET_STALL_DECEL_COUNT  ) = 0;
+  *((uint8_t*)cpba + FS_ETPU_CRANK_OFFSET_STALL_PREDICTED_COUNT) = 0;
   /* 16-bit */
   misscnt_mask = p_crank_instance->teeth_in_gap << 13;
   misscnt_mask = (misscnt_mask & 0x6000) | ((misscnt_mask & 0x8000)>>5);
@@ -233,12 +275,18 @@ uint32_t fs_etpu_crank_init(
   *(cpba + (FS_ETPU_CRANK_OFFSET_LINK_2   >>2)) = p_crank_instance->link_2;
   *(cpba + (FS_ETPU_CRANK_OFFSET_LINK_3   >>2)) = p_crank_instance->link_3;
   *(cpba + (FS_ETPU_CRANK_OFFSET_LINK_4   >>2)) = p_crank_instance->link_4;
+  for(i=0; i<p_crank_instance->link_extra_count; i++)
+  {
+    *(cpba_link_extra + i) = p_crank_instance->p_link_extra[i];
+  }
 
   /* Write global parameters */
   *((uint32_t*)fs_etpu_data_ram_start + ((FS_ETPU_OFFSET_ENG_CYCLE_TCR2_TICKS -1)>>2)) =
     p_crank_instance->tcr2_ticks_per_tooth * p_crank_instance->teeth_per_cycle;
   *((uint32_t*)fs_etpu_data_ram_start + ((FS_ETPU_OFFSET_ENG_CYCLE_TCR2_START -1)>>2)) = 0;
   *((uint8_t*)fs_etpu_data_ram_start + FS_ETPU_OFFSET_ENG_POS_STATE) = FS_ETPU_ENG_POS_SEEK;
+  *((uint32_t*)fs_etpu_data_ram_start + ((FS_ETPU_OFFSET_ENG_TRR_NORM_HIGHRES -1)>>2)) =
+    p_crank_config->trr_norm_highres;
 
   /* Write HSR */
   eTPU->CHAN[chan_num].HSRR.R = FS_ETPU_CRANK_HSR_INIT;
@@ -263,6 +311,8 @@ uint32_t fs_etpu_crank_init(
 *            parameters @ref crank_config_t.
 *
 * @return  Error codes that can be returned are:
+*          - @ref FS_ETPU_ERROR_VALUE - stall_decel_ratio is not lower than
+*            win_ratio_normal
 *          - @ref FS_ETPU_ERROR_NONE - No error
 *
 *******************************************************************************/
@@ -276,6 +326,13 @@ uint32_t fs_etpu_crank_config(
   cpba = p_crank_instance->cpba;
   cpbae = cpba + (0x4000 >> 2); /* sign-extended memory area */
 
+  /* Check a decelerating tooth can be accepted in the normal window */
+  if((p_crank_config->stall_decel_teeth != 0) &&
+     (p_crank_config->stall_decel_ratio >= p_crank_config->win_ratio_normal))
+  {
+    return(FS_ETPU_ERROR_VALUE);
+  }
+
   /* Write channel parameters */
   /* 24-bit - use cpbae to prevent from overwriting bits 31:24 */
   *(cpbae + ((FS_ETPU_CRANK_OFFSET_BLANK_TIME              - 1)>>2)) = p_crank_config->blank_time;
@@ -285,9 +342,14 @@ uint32_t fs_etpu_crank_config(
   *(cpbae + ((FS_ETPU_CRANK_OFFSET_WIN_RATIO_AFTER_GAP     - 1)>>2)) = p_crank_config->win_ratio_after_gap;
   *(cpbae + ((FS_ETPU_CRANK_OFFSET_WIN_RATIO_AFTER_TIMEOUT - 1)>>2)) = p_crank_config->win_ratio_after_timeout;
   *(cpbae + ((FS_ETPU_CRANK_OFFSET_FIRST_TOOTH_TIMEOUT     - 1)>>2)) = p_crank_config->first_tooth_timeout;
+  *(cpbae + ((FS_ETPU_CRANK_OFFSET_STALL_DECEL_RATIO       - 1)>>2)) = p_crank_config->stall_decel_ratio;
   /* 8-bit */
   *((uint8_t*)cpba + FS_ETPU_CRANK_OFFSET_TEETH_PER_SYNC) = p_crank_config->teeth_per_sync;
   *((uint8_t*)cpba + FS_ETPU_CRANK_OFFSET_BLANK_TEETH   ) = p_crank_config->blank_teeth;
+  *((uint8_t*)cpba + FS_ETPU_CRANK_OFFSET_STALL_DECEL_TEETH) = p_crank_config->stall_decel_teeth;
+
+  /* Write global parameters */
+  fs_etpu_set_global_24(FS_ETPU_OFFSET_ENG_TRR_NORM_HIGHRES, p_crank_config->trr_norm_highres);
 
   return(FS_ETPU_ERROR_NONE);
 }
@@ -327,6 +389,8 @@ uint32_t fs_etpu_crank_get_states(
   p_crank_states->tooth_counter_cycle = *((uint8_t*)cpba + FS_ETPU_CRANK_OFFSET_TOOTH_COUNTER_CYCLE);
   p_crank_states->last_tooth_period   = *(cpbae + ((FS_ETPU_CRANK_OFFSET_LAST_TOOTH_PERIOD - 1)>>2));
   p_crank_states->last_tooth_period_norm = *(cpbae + ((FS_ETPU_CRANK_OFFSET_LAST_TOOTH_PERIOD_NORM - 1)>>2));
+  p_crank_states->tooth_latency_max  = *(cpbae + ((FS_ETPU_CRANK_OFFSET_TOOTH_LATENCY_MAX - 1)>>2));
+  p_crank_states->stall_predicted_count = *((uint8_t*)cpba + FS_ETPU_CRANK_OFFSET_STALL_PREDICTED_COUNT);
   p_crank_states->error              |= *((uint8_t*)cpba + FS_ETPU_CRANK_OFFSET_ERROR);
   /* Clear Crank error */
   *((uint8_t*)cpba + FS_ETPU_CRANK_OFFSET_ERROR) = 0;
@@ -373,6 +437,59 @@ uint32_t fs_etpu_crank_set_sync(
   return(FS_ETPU_ERROR_NONE);
 }
 
+/*******************************************************************************
+* FUNCTION: fs_etpu_crank_resync
+****************************************************************************//*!
+* @brief   This function asks the eTPU to drop the synchronization and restart
+*          it from seeking the gap, the same way as on a stall. The stall links
+*          are sent, the global engine position status is set to SEEK and
+*          the error FS_ETPU_CRANK_ERR_STALL is set.
+*          Use it when the engine phase is found wrong, e.g. on
+*          FS_ETPU_CAM_ERROR_PHASE.
+*
+*          The CRANK_EMUL function uses the same HSR number for
+*          SET_SPEED, so the call is rejected on a channel which does not run
+*          the CRANK function.
+*
+* @note    The following actions are performed in order:
+*          -# Check the channel runs the CRANK function
+*          -# Check HSR is 0
+*          -# Write HSR FS_ETPU_CRANK_HSR_RESYNC
+*
+* @param   *p_crank_instance - This is a pointer to the instance structure
+*            @ref crank_instance_t.
+*
+* @return  Error codes that can be returned are:
+*          - @ref FS_ETPU_ERROR_NONE - No error.
+*          - @ref FS_ETPU_ERROR_VALUE - The channel does not run the CRANK
+*              function, e.g. it runs CRANK_EMUL.
+*          - @ref FS_ETPU_ERROR_TIMING - The resync was not requested because
+*              there is a HSR pending on the eTPU channel.
+*              Try to repeat the function call several microseconds later.
+*
+*******************************************************************************/
+uint32_t fs_etpu_crank_resync(
+  struct crank_instance_t *p_crank_instance)
+{
+  /* Check the channel runs CRANK - HSR 2 is SET_SPEED on CRANK_EMUL */
+  if(eTPU->CHAN[p_crank_instance->chan_num].CR.B.CFS != FS_ETPU_CRANK_FUNCTION_NUMBER)
+  {
+    return(FS_ETPU_ERROR_VALUE);
+  }
+  /* Check there is no pending HSR */
+  else if(eTPU->CHAN[p_crank_instance->chan_num].HSRR.R != 0)
+  {
+    return(FS_ETPU_ERROR_TIMING);
+  }
+  else
+  {
+    /* Write HSR */
+    eTPU->CHAN[p_crank_instance->chan_num].HSRR.R = FS_ETPU_CRANK_HSR_RESYNC;
+
+    return(FS_ETPU_ERROR_NONE);
+  }
+}
+
 
 /*******************************************************************************
 * FUNCTION: fs_etpu_crank_copy_tooth_period_log
@@ -470,6 +587,25 @@ uint32_t fs_etpu_crank_get_angle_reseting(void)
  *
  * FILE OWNER: Milan Brejl [r54529]
  *
+ * Revision 1.8  2026/10/18
+ * tooth_latency_max is not cleared by fs_etpu_crank_get_states() any more.
+ *
+ * Revision 1.7  2026/10/18
+ * Stall prediction parameters stall_decel_ratio, stall_decel_teeth and
+ * stall_predicted_count added.
+ *
+ * Revision 1.6  2026/10/18
+ * fs_etpu_crank_resync() added.
+ *
+ * Revision 1.5  2026/10/18
+ * Additional link sets (link_extra_count, p_link_extra) written on init.
+ *
+ * Revision 1.4  2026/10/18
+ * Parameter crank_states_t.tooth_latency_max added.
+ *
+ * Revision 1.3  2026/10/18
+ * Parameter crank_config_t.trr_norm_highres added.
+ *
  * Revision 1.2  2015/09/01  r54529
  * Parameter crank_states_t.last_tooth_period_norm added.
  * 
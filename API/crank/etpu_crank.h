@@ -67,13 +67,19 @@ struct crank_instance_t
     log. Up to 4 Cam channel numbers can be used. In case of a single Cam on
     channel 1, use 0x01010101. */
   const uint32_t link_1;    /**< The first  set of 4 link numbers to send when
-    stall conditions accure. */
+    stall conditions accure. The links are sent first (critical
+    channels, e.g. SPARK and FUEL) on stall and on reaching the full sync. */
   const uint32_t link_2;    /**< The second set of 4 link numbers to send when
-    stall conditions accure. */
+    stall conditions accure. The links are sent first (critical
+    channels, e.g. SPARK and FUEL) on stall and on reaching the full sync. */
   const uint32_t link_3;    /**< The third  set of 4 link numbers to send when
-    stall conditions accure. */
+    stall conditions accure. The links are sent from a deferred
+    CRANK channel service, after link_1 and link_2 (non-critical channels,
+    e.g. KNOCK and INJ). */
   const uint32_t link_4;    /**< The fourth set of 4 link numbers to send when
-    stall conditions accure. */
+    stall conditions accure. The links are sent from a deferred
+    CRANK channel service, after link_1 and link_2 (non-critical channels,
+    e.g. KNOCK and INJ). */
         uint32_t *cpba;     /**< Channel parameter base address.
     Set cpba = 0 to use automatic allocation of eTPU DATA RAM for CRANK channel
     parameters using the eTPU utility function fs_etpu_malloc (recommanded),
@@ -85,6 +91,19 @@ struct crank_instance_t
     function fs_etpu_malloc (recommanded), or assign the p_tooth_period_log
     manually by an address where the CRANK buffer will start. The memory does
     not need to be allocated if FS_ETPU_CRANK_FM1_TOOTH_PERIODS_LOG_OFF is set.*/
+  const uint8_t  link_extra_count; /**< The count of additional sets of 4 link
+    numbers to send when stall conditions accure, in addition to link_1 to
+    link_4. The additional links are sent from the deferred CRANK channel
+    services, after link_3 and link_4, two sets per service. Use it for engines with more than 16
+    angle-based channels. Set link_extra_count = 0 if not used. */
+  const uint32_t *p_link_extra; /**< Pointer to an array of link_extra_count
+    additional sets of 4 link numbers. */
+        uint32_t *cpba_link_extra; /**< Base address of the additional link
+    sets array in eTPU DATA RAM. Set cpba_link_extra = 0 to use automatic
+    allocation of eTPU DATA RAM for this array using the eTPU utility
+    function fs_etpu_malloc (recommanded), or assign the cpba_link_extra
+    manually by an address where the array will start. The memory does
+    not need to be allocated if link_extra_count = 0. */
 };
 
 /** A structure to represent a configuration of CRANK.
@@ -116,6 +135,27 @@ struct crank_config_t
     the acceptance window for the tooth following a timeout condition. */
         uint24_t first_tooth_timeout; /**< A TCR1 time period after the first
     tooth (after blank_teeth) when a timeout will be deemed to have happened. */
+        uint24_t trr_norm_highres; /**< The engine speed threshold for the
+    time-to-angle conversion precision used by the engine timing functions
+    (SPARK and FUEL start angles). It is compared to the normalized tick rate
+    eng_trr_norm = (tooth_period / tcr2_ticks_per_tooth) << 9, where
+    tooth_period is in TCR1 ticks. The high resolution conversion is used while
+    eng_trr_norm >= trr_norm_highres, the quicker low resolution conversion
+    at higher speeds. Set trr_norm_highres = 0 to always use the high
+    resolution conversion. */
+        ufract24_t stall_decel_ratio; /**< A fraction used to detect
+    a decelerating tooth for the stall prediction. A tooth is decelerating when
+      tooth_period > (1 + stall_decel_ratio) * last_tooth_period.
+    A tooth later than (1 + win_ratio_normal) * last_tooth_period times out,
+    hence stall_decel_ratio must be lower than win_ratio_normal, otherwise
+    FS_ETPU_ERROR_VALUE is returned. */
+        uint8_t  stall_decel_teeth; /**< A number of consecutive decelerating
+    teeth which predicts a stall. The stall is declared on the last of them
+    without waiting for the stretched acceptance windows to close. A tooth
+    timeout following a decelerating tooth counts as a decelerating tooth. The lower the values of
+    stall_decel_ratio and stall_decel_teeth, the more aggressive the stall
+    prediction is. Set stall_decel_teeth = 0 to disable the stall
+    prediction. */
 };
 
 /** A structure to represent internal states of CRANK. */
@@ -160,6 +200,11 @@ struct crank_states_t
     of TCR1 ticks. */
        uint24_t last_tooth_period_norm; /**< The last tooth period normalized
     over the gap or over the additional tooth as a number of TCR1 ticks. */
+       uint24_t tooth_latency_max; /**< The worst-case latency of the tooth
+    transition service since initialization, as a number of TCR1 ticks.
+    It is maintained by the eTPU only and never cleared by the CPU. */
+        uint8_t stall_predicted_count; /**< The count of stalls declared by the
+    stall prediction (modulo 256). */
 };
 
 /*******************************************************************************
@@ -185,6 +230,10 @@ uint32_t fs_etpu_crank_set_sync(
   struct crank_instance_t *p_crank_instance,
                  uint24_t tcr2_adjustment);
 
+/* Restart synchronization */
+uint32_t fs_etpu_crank_resync(
+  struct crank_instance_t *p_crank_instance);
+
 /* Copy tooth_period_log */
 uint24_t *fs_etpu_crank_copy_tooth_period_log(
   struct crank_instance_t *p_crank_instance,
@@ -230,6 +279,27 @@ uint32_t fs_etpu_crank_get_angle_reseting(void);
  *
  * FILE OWNER: Milan Brejl [r54529]
  *
+ * Revision 1.8  2026/10/18
+ * crank_states_t.tooth_latency_max is free-running since initialization.
+ *
+ * Revision 1.7  2026/10/18
+ * Parameters crank_config_t.stall_decel_ratio, stall_decel_teeth and
+ * crank_states_t.stall_predicted_count added.
+ *
+ * Revision 1.6  2026/10/18
+ * fs_etpu_crank_resync() added.
+ *
+ * Revision 1.5  2026/10/18
+ * Parameters crank_instance_t.link_extra_count, p_link_extra and
+ * cpba_link_extra added.
+ *
+ * Revision 1.4  2026/10/18
+ * Parameter crank_states_t.tooth_latency_max added. Links link_3 and link_4
+ * are sent after link_1 and link_2.
+ *
+ * Revision 1.3  2026/10/18
+ * Parameter crank_config_t.trr_norm_highres added.
+ *
  * Revision 1.2  2015/09/01  r54529
  * Parameter crank_states_t.last_tooth_period_norm added.
  * 
@@ -332,6 +332,28 @@ uint32_t fs_etpu_crank_set_speed(
 }
 
 
+/*******************************************************************************
+* FUNCTION: fs_etpu_crank_resync - not supported by EMUL
+****************************************************************************//*!
+* @brief   CRANK_EMUL does not process any crank signal, so there is no
+*          synchronization to restart. This function only rejects the request,
+*          without any HSR, because HSR FS_ETPU_CRANK_HSR_RESYNC of CRANK
+*          is HSR FS_ETPU_CRANK_HSR_SET_SPEED of CRANK_EMUL.
+*
+* @param   *p_crank_instance - This is a pointer to the instance structure
+*            @ref crank_instance_t.
+*
+* @return  Error codes that can be returned are:
+*          - @ref FS_ETPU_ERROR_VALUE - Resync is not supported by CRANK_EMUL.
+*
+*******************************************************************************/
+uint32_t fs_etpu_crank_resync(
+  struct crank_instance_t *p_crank_instance)
+{
+  return(FS_ETPU_ERROR_VALUE);
+}
+
+
 /*******************************************************************************
 * FUNCTION: fs_etpu_crank_copy_tooth_period_log
 ****************************************************************************//*!
@@ -404,6 +426,9 @@ uint24_t *fs_etpu_crank_copy_tooth_period_log(
  *
  * FILE OWNER: Milan Brejl [r54529]
  *
+ * Revision 1.1  2026/10/18
+ * fs_etpu_crank_resync added, it rejects the request.
+ *
  * Revision 1.0  2014/03/16  r54529
  * Minor comment and formating improvements.
  * Ready for eTPU Engine Control Library release 1.0.
@@ -181,6 +181,10 @@ uint32_t fs_etpu_crank_set_speed(
   struct crank_instance_t *p_crank_instance,
                  uint24_t tooth_period);
 
+/* Resync - not supported by EMUL */
+uint32_t fs_etpu_crank_resync(
+  struct crank_instance_t *p_crank_instance);
+
 /* Copy tooth_period_log */
 uint24_t *fs_etpu_crank_copy_tooth_period_log(
   struct crank_instance_t *p_crank_instance,
@@ -223,6 +227,9 @@ uint24_t *fs_etpu_crank_copy_tooth_period_log(
  *
  * FILE OWNER: Milan Brejl [r54529]
  *
+ * Revision 1.1  2026/10/18
+ * Prototype of fs_etpu_crank_resync added.
+ *
  * Revision 1.0  2014/03/16  r54529
  * Minor comment and formating improvements.
  * Ready for eTPU Engine Control Library release 1.0.
@@ -55,6 +55,10 @@
 *     the main or an additional one, is shorter than the injection_time_minimum
 *     and hence not generated, skipped. The commanded injection_time and
 *     the injection_time_applied may differ.
+*   @ref FS_ETPU_FUEL_ERROR_END_ANGLE_APPLIED - in FS_ETPU_FUEL_END_MODE_ANGLE,
+*     the main injection pulse end has been moved to angle_normal_end because
+*     of an engine speed change. The commanded injection_time and
+*     the injection_time_applied may differ.
 *
 * Channel interrupt is generated once every engine cycle, on the angle_stop.
 *
@@ -101,6 +105,7 @@ uint32_t fs_etpu_fuel_init(
   uint8_t  chan_num;
   uint8_t  priority;
   uint32_t *cpba;
+  uint8_t  i;
 
   chan_num = p_fuel_instance->chan_num;
   priority = p_fuel_instance->priority;
@@ -144,9 +149,21 @@ uint32_t fs_etpu_fuel_init(
   *(cpba + ((FS_ETPU_FUEL_OFFSET_INJECTION_START_ANGLE_CPU - 1)>>2)) = 0;
   *(cpba + ((FS_ETPU_FUEL_OFFSET_PULSE_START_TIME          - 1)>>2)) = 0;
   *(cpba + ((FS_ETPU_FUEL_OFFSET_PULSE_END_TIME            - 1)>>2)) = 0;
+  *(cpba + ((FS_ETPU_FUEL_OFFSET_ANGLE_END_TOLERANCE       - 1)>>2)) = p_fuel_config->angle_end_tolerance;
+  *(cpba + ((FS_ETPU_FUEL_OFFSET_END_TIME_DEVIATION_MAX    - 1)>>2)) = p_fuel_config->end_time_deviation_max;
+  *(cpba + ((FS_ETPU_FUEL_OFFSET_RECALC_ACCEL_RATIO        - 1)>>2)) = p_fuel_config->recalc_accel_ratio;
+  *(cpba + ((FS_ETPU_FUEL_OFFSET_RECALC_LEAD_TIME          - 1)>>2)) = p_fuel_config->recalc_lead_time;
+  *(cpba + ((FS_ETPU_FUEL_OFFSET_ANGLE_OFFSET_RECALC_MIN   - 1)>>2)) = p_fuel_config->angle_offset_recalc_min;
+  *(cpba + ((FS_ETPU_FUEL_OFFSET_LATENESS_BUCKET_TIME      - 1)>>2)) = p_fuel_config->lateness_bucket_time;
+  for(i=0; i<FS_ETPU_LATENESS_BUCKET_COUNT; i++)
+  {
+    *(cpba + ((FS_ETPU_FUEL_OFFSET_LATENESS_HIST - 1)>>2) + i) = 0;
+  }
   /* 8-bit */
   *((uint8_t*)cpba + FS_ETPU_FUEL_OFFSET_ERROR) = 0;
   *((uint8_t*)cpba + FS_ETPU_FUEL_OFFSET_GENERATION_DISABLE ) = p_fuel_config->generation_disable;
+  *((uint8_t*)cpba + FS_ETPU_FUEL_OFFSET_END_MODE           ) = p_fuel_config->end_mode;
+  *((uint8_t*)cpba + FS_ETPU_FUEL_OFFSET_RECALC_COUNT_MAX   ) = p_fuel_config->recalc_count_max;
 
   /* Write HSR */
   eTPU->CHAN[chan_num].HSRR.R = FS_ETPU_FUEL_HSR_INIT;
@@ -197,8 +214,16 @@ uint32_t fs_etpu_fuel_config(
   *(cpbae + ((FS_ETPU_FUEL_OFFSET_COMPENSATION_TIME      - 1)>>2)) = p_fuel_config->compensation_time;
   *(cpbae + ((FS_ETPU_FUEL_OFFSET_INJECTION_TIME_MINIMUM - 1)>>2)) = p_fuel_config->injection_time_minimum;
   *(cpbae + ((FS_ETPU_FUEL_OFFSET_OFF_TIME_MINIMUM       - 1)>>2)) = p_fuel_config->off_time_minimum;
+  *(cpbae + ((FS_ETPU_FUEL_OFFSET_ANGLE_END_TOLERANCE    - 1)>>2)) = p_fuel_config->angle_end_tolerance;
+  *(cpbae + ((FS_ETPU_FUEL_OFFSET_END_TIME_DEVIATION_MAX - 1)>>2)) = p_fuel_config->end_time_deviation_max;
+  *(cpbae + ((FS_ETPU_FUEL_OFFSET_RECALC_ACCEL_RATIO     - 1)>>2)) = p_fuel_config->recalc_accel_ratio;
+  *(cpbae + ((FS_ETPU_FUEL_OFFSET_RECALC_LEAD_TIME       - 1)>>2)) = p_fuel_config->recalc_lead_time;
+  *(cpbae + ((FS_ETPU_FUEL_OFFSET_ANGLE_OFFSET_RECALC_MIN - 1)>>2)) = p_fuel_config->angle_offset_recalc_min;
+  *(cpbae + ((FS_ETPU_FUEL_OFFSET_LATENESS_BUCKET_TIME    - 1)>>2)) = p_fuel_config->lateness_bucket_time;
   /* 8-bit */
   *((uint8_t*)cpba + FS_ETPU_FUEL_OFFSET_GENERATION_DISABLE) = p_fuel_config->generation_disable;
+  *((uint8_t*)cpba + FS_ETPU_FUEL_OFFSET_END_MODE          ) = p_fuel_config->end_mode;
+  *((uint8_t*)cpba + FS_ETPU_FUEL_OFFSET_RECALC_COUNT_MAX  ) = p_fuel_config->recalc_count_max;
 
   return(FS_ETPU_ERROR_NONE);
 }
@@ -264,6 +289,7 @@ uint32_t fs_etpu_fuel_update_injection_time(
 * @note    The following actions are performed in order:
 *          -# Read state parameter values from eTPU DATA RAM
 *          -# Clear FUEL error
+*          -# Accumulate the lateness histogram counts
 *
 * @param   *p_fuel_instance - This is a pointer to the instance structure
 *            @ref p_fuel_instance.
@@ -280,6 +306,8 @@ uint32_t fs_etpu_fuel_get_states(
 {
   uint32_t *cpba;
   uint32_t *cpbae;
+  uint32_t count;
+  uint8_t  i;
 
   cpba  = p_fuel_instance->cpba;
   cpbae = cpba + (0x4000 >> 2); /* sign-extended memory area */
@@ -290,6 +318,14 @@ uint32_t fs_etpu_fuel_get_states(
   p_fuel_states->error                 |= *((uint8_t*)cpba + FS_ETPU_FUEL_OFFSET_ERROR);
   /* Clear FUEL error */
   *((uint8_t*)cpba + FS_ETPU_FUEL_OFFSET_ERROR) = 0;
+  /* Accumulate the increments of the free-running lateness histogram */
+  for(i=0; i<FS_ETPU_LATENESS_BUCKET_COUNT; i++)
+  {
+    count = 0x00FFFFFF & *(cpba + ((FS_ETPU_FUEL_OFFSET_LATENESS_HIST - 1)>>2) + i);
+    p_fuel_states->lateness_hist[i] +=
+      0x00FFFFFF & (count - p_fuel_states->lateness_hist_last[i]);
+    p_fuel_states->lateness_hist_last[i] = count;
+  }
 
   return(FS_ETPU_ERROR_NONE);
 }
@@ -329,6 +365,19 @@ uint32_t fs_etpu_fuel_get_states(
  *
  * FILE OWNER: Milan Brejl [r54529]
  *
+ * Revision 1.4  2026/10/18
+ * Addition of end_time_deviation_max.
+ *
+ * Revision 1.3  2026/10/18
+ * Addition of lateness_bucket_time and lateness_hist.
+ *
+ * Revision 1.2  2026/10/18
+ * Addition of recalc_count_max, recalc_accel_ratio, recalc_lead_time and
+ * angle_offset_recalc_min.
+ *
+ * Revision 1.1  2026/10/18
+ * Addition of end_mode and angle_end_tolerance.
+ *
  * Revision 1.0  2014/03/17  r54529
  * Minor comment and formating improvements.
  * Ready for eTPU Engine Control Library release 1.0.
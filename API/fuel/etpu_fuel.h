@@ -73,7 +73,9 @@ struct fuel_config_t
     calculated according to the actual engine speed. The calculation is repeated
     once again in order to adjust to a speed change at a defined angular
     position before the originaly calculated start_angle. This position is given
-    by angle_offset_recalc. */
+    by angle_offset_recalc.
+    If recalc_lead_time is set, angle_offset_recalc is the maximum
+    recalculation offset angle. */
   uint24_t injection_time; /**< A TCR1 time determining the fuel injection
     pulse width, corresponding to the amount of fuel injected by one fuel
     injector in each engine cycle. */
@@ -98,6 +100,48 @@ struct fuel_config_t
     a pulse which has already been started will be correctly finished.
     FS_ETPU_FUEL_GENERATION_ALLOWED switches the injection pulse generation
     on. */
+  uint8_t  end_mode;  /**< This parameter selects how the injection pulse
+    end is controlled. It can be assigned one of the values:
+    - @ref FS_ETPU_FUEL_END_MODE_TIME - the pulse is generated purely in time
+      after the start angle, the end angle drifts from angle_normal_end when
+      the engine speed changes.
+    - @ref FS_ETPU_FUEL_END_MODE_ANGLE - the main pulse end is re-evaluated
+      in the middle of the pulse using the actual engine speed. If it would
+      miss angle_normal_end by more than angle_end_tolerance, the pulse ends
+      at angle_normal_end and the error flag
+      @ref FS_ETPU_FUEL_ERROR_END_ANGLE_APPLIED is set. */
+   int24_t angle_end_tolerance;  /**< The tolerance of the injection end
+    angle as a number of TCR2 ticks, used in FS_ETPU_FUEL_END_MODE_ANGLE. */
+  ufract24_t end_time_deviation_max;  /**< The maximum change of the main
+    pulse time caused by ending the pulse at angle_normal_end, as a fraction
+    of the pulse time, used in FS_ETPU_FUEL_END_MODE_ANGLE. The pulse end is
+    kept within this deviation from the time-based end (and the pulse is not
+    shortened below injection_time_minimum), so that a quick acceleration
+    or deceleration cannot cut or stretch the injection without limit. */
+  uint8_t  recalc_count_max;  /**< The maximum count of extra start angle
+    recalculations. An extra recalculation is done, at a quarter of the
+    previous recalculation offset before the start angle, only while the tooth
+    period changes by recalc_accel_ratio or more from tooth to tooth.
+    Set recalc_count_max = 0 to use no extra recalculation. */
+  ufract24_t recalc_accel_ratio;  /**< The tooth period change, as a fraction
+    of the tooth period, which triggers an extra start angle recalculation.
+    Set recalc_accel_ratio = 0 to do recalc_count_max extra recalculations
+    always. */
+  uint24_t recalc_lead_time;  /**< The optional recalculation lead time as
+    a number of TCR1 ticks. If set, the recalculation offset angle is not
+    fixed: the lead time is converted to angle using the actual engine speed
+    every cycle and bounded by angle_offset_recalc_min and angle_offset_recalc.
+    This keeps the time between the recalculation and the start angle constant
+    over the engine speed range. Set recalc_lead_time = 0 to use the fixed
+    angle_offset_recalc. */
+   int24_t angle_offset_recalc_min;  /**< The minimum recalculation offset
+    angle as a number of TCR2 ticks, used with recalc_lead_time. */
+  uint24_t lateness_bucket_time;  /**< The output edge lateness histogram
+    bucket time as a number of TCR1 ticks. The lateness of each output edge
+    service is counted in one of FS_ETPU_LATENESS_BUCKET_COUNT buckets:
+    below lateness_bucket_time, below 4x, below 16x, and above (including
+    edges which were already in the past when scheduled).
+    Set lateness_bucket_time = 0 to disable the histogram. */
 };
 
 /** A structure to represent states of FUEL. */
@@ -107,6 +151,7 @@ struct fuel_states_t
     include the following error flags:
     - @ref FS_ETPU_FUEL_ERROR_STOP_ANGLE_APPLIED
     - @ref FS_ETPU_FUEL_ERROR_MINIMUM_INJ_TIME_APPLIED
+    - @ref FS_ETPU_FUEL_ERROR_END_ANGLE_APPLIED
     The eTPU sets the error flags, the CPU clears them after reading. */
   uint24_t injection_time_applied;  /**< This is the applied injection
     time of the last injection. The value corresponds to commanded
@@ -114,6 +159,14 @@ struct fuel_states_t
     late call of @ref fs_etpu_fuel_update_injection_time(). */
   int24_t injection_start_angle;  /**< This is the last injection
     tdc_angle-relative start angle as a number of TCR2 ticks. */
+  uint32_t lateness_hist[FS_ETPU_LATENESS_BUCKET_COUNT];  /**< The output
+    edge lateness histogram - counts of output edges per lateness bucket,
+    see lateness_bucket_time. The eTPU counters are free-running, the CPU
+    accumulates their increments since the last reading. */
+  uint24_t lateness_hist_last[FS_ETPU_LATENESS_BUCKET_COUNT];  /**< The eTPU
+    lateness histogram counter values at the last reading, used internally.
+    Clear it together with lateness_hist when the channel is initialized
+    again. */
 };
 
 /*******************************************************************************
@@ -175,6 +228,19 @@ uint32_t fs_etpu_fuel_get_states(
  *
  * FILE OWNER: Milan Brejl [r54529]
  *
+ * Revision 1.4  2026/10/18
+ * Addition of end_time_deviation_max.
+ *
+ * Revision 1.3  2026/10/18
+ * Addition of lateness_bucket_time and lateness_hist.
+ *
+ * Revision 1.2  2026/10/18
+ * Addition of recalc_count_max, recalc_accel_ratio, recalc_lead_time and
+ * angle_offset_recalc_min.
+ *
+ * Revision 1.1  2026/10/18
+ * Addition of end_mode and angle_end_tolerance.
+ *
  * Revision 1.0  2014/03/17  r54529
  * Minor comment and formating improvements.
  * Ready for eTPU Engine Control Library release 1.0.
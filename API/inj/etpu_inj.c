@@ -235,6 +235,11 @@ uint32_t fs_etpu_inj_init(
   *(cpba + ((FS_ETPU_INJ_OFFSET_ANGLE_STOP        - 1)>>2)) = p_inj_config->angle_stop;
   *(cpba + ((FS_ETPU_INJ_OFFSET_TDC_ANGLE         - 1)>>2)) = p_inj_instance->tdc_angle;
   *(cpba + ((FS_ETPU_INJ_OFFSET_TDC_ANGLE_ACTUAL  - 1)>>2)) = p_inj_instance->tdc_angle;
+  *(cpba + ((FS_ETPU_INJ_OFFSET_LATENESS_BUCKET_TIME - 1)>>2)) = p_inj_config->lateness_bucket_time;
+  for(i=0; i<FS_ETPU_LATENESS_BUCKET_COUNT; i++)
+  {
+    *(cpba + ((FS_ETPU_INJ_OFFSET_LATENESS_HIST - 1)>>2) + i) = 0;
+  }
 
   /* 8-bit */
   *((uint8_t*)cpba + FS_ETPU_INJ_OFFSET_INJECTION_COUNT  ) = injection_count;
@@ -355,6 +360,7 @@ uint32_t fs_etpu_inj_config(
     cpbae = cpba + (0x4000 >> 2); /* sign-extended memory area */
     *(cpbae + ((FS_ETPU_INJ_OFFSET_ANGLE_IRQ  - 1)>>2)) = p_inj_config->angle_irq;
     *(cpbae + ((FS_ETPU_INJ_OFFSET_ANGLE_STOP - 1)>>2)) = p_inj_config->angle_stop;
+    *(cpbae + ((FS_ETPU_INJ_OFFSET_LATENESS_BUCKET_TIME - 1)>>2)) = p_inj_config->lateness_bucket_time;
 
     /* 8-bit */
     injection_count = p_inj_config->injection_count;
@@ -401,6 +407,7 @@ uint32_t fs_etpu_inj_config(
 * @note    The following actions are performed in order:
 *          -# Read state parameter values from eTPU DATA RAM
 *          -# Clear INJ error
+*          -# Accumulate the lateness histogram counts
 *
 * @param   *p_inj_instance - This is a pointer to the instance structure
 *            @ref inj_instance_t.
@@ -416,6 +423,8 @@ uint32_t fs_etpu_inj_get_states(
   struct inj_states_t   *p_inj_states)
 {
   uint32_t *cpba;
+  uint32_t count;
+  uint8_t  i;
 
   cpba = p_inj_instance->cpba;
 
@@ -425,6 +434,14 @@ uint32_t fs_etpu_inj_get_states(
   p_inj_states->error         = *((uint8_t*)cpba + FS_ETPU_INJ_OFFSET_ERROR);
   /* Clear INJ error */
   *((uint8_t*)cpba + FS_ETPU_INJ_OFFSET_ERROR) = 0;
+  /* Accumulate the increments of the free-running lateness histogram */
+  for(i=0; i<FS_ETPU_LATENESS_BUCKET_COUNT; i++)
+  {
+    count = 0x00FFFFFF & *(cpba + ((FS_ETPU_INJ_OFFSET_LATENESS_HIST - 1)>>2) + i);
+    p_inj_states->lateness_hist[i] +=
+      0x00FFFFFF & (count - p_inj_states->lateness_hist_last[i]);
+    p_inj_states->lateness_hist_last[i] = count;
+  }
 
   return(FS_ETPU_ERROR_NONE);
 }
@@ -464,6 +481,9 @@ uint32_t fs_etpu_inj_get_states(
  *
  * FILE OWNER: Milan Brejl [r54529]
  *
+ * Revision 1.1  2026/10/18
+ * Addition of lateness_bucket_time and lateness_hist.
+ *
  * Revision 1.0  2014/03/17  r54529
  * Minor comment and formating improvements.
  * Ready for eTPU Engine Control Library release 1.0.
@@ -105,6 +105,12 @@ struct inj_config_t
   uint8_t  injection_count;  /**< The count of injections. */
   struct inj_injection_config_t *p_injection_config; /**< Pointer to the first
     item of an array of the injection configuration structures. */
+  uint24_t lateness_bucket_time;  /**< The output edge lateness histogram
+    bucket time as a number of TCR1 ticks. The lateness of each output edge
+    service is counted in one of FS_ETPU_LATENESS_BUCKET_COUNT buckets:
+    below lateness_bucket_time, below 4x, below 16x, and above (including
+    edges which were already in the past when scheduled).
+    Set lateness_bucket_time = 0 to disable the histogram. */
 };
 
 
@@ -152,6 +158,14 @@ struct inj_states_t
   uint8_t phase_idx; /**< This is the index of the actual injection phase.
     It can be 1 to num_phases in case an injection phase is active, or 0 in case
     no injection phase is active. */
+  uint32_t lateness_hist[FS_ETPU_LATENESS_BUCKET_COUNT];  /**< The output
+    edge lateness histogram - counts of output edges per lateness bucket,
+    see lateness_bucket_time. The eTPU counters are free-running, the CPU
+    accumulates their increments since the last reading. */
+  uint24_t lateness_hist_last[FS_ETPU_LATENESS_BUCKET_COUNT];  /**< The eTPU
+    lateness histogram counter values at the last reading, used internally.
+    Clear it together with lateness_hist when the channel is initialized
+    again. */
 };
 
 
@@ -209,6 +223,9 @@ uint32_t fs_etpu_inj_get_states(
  *
  * FILE OWNER: Milan Brejl [r54529]
  *
+ * Revision 1.1  2026/10/18
+ * Addition of lateness_bucket_time and lateness_hist.
+ *
  * Revision 1.0  2014/03/17  r54529
  * Minor comment and formating improvements.
  * Ready for eTPU Engine Control Library release 1.0.
@@ -49,6 +49,12 @@
 *     eng_angle. Hence, the commanded dwell_time and the dwell_time_applie 
 *     may differ.
 *
+* At cranking speeds, the spark main pulse end can be timed from a reference
+* crank tooth edge (cranking_tooth_angle) plus a TCR1 delay (cranking_delay),
+* instead of the end_angle, which relies on the engine speed extrapolation.
+* The cranking mode is applied while the crank tooth period is longer than
+* cranking_tooth_period.
+*
 * Channel interrupt is generated before each single spark, on the recalc_angle.
 *
 *******************************************************************************/
@@ -155,6 +161,17 @@ uint32_t fs_etpu_spark_init(
   *(cpba + ((FS_ETPU_SPARK_OFFSET_DWELL_TIME_APPLIED   - 1)>>2)) = 0;
   *(cpba + ((FS_ETPU_SPARK_OFFSET_DWELL_TIME           - 1)>>2)) = 0;
   *(cpba + ((FS_ETPU_SPARK_OFFSET_END_ANGLE            - 1)>>2)) = 0;
+  *(cpba + ((FS_ETPU_SPARK_OFFSET_RECALC_ACCEL_RATIO    - 1)>>2)) = p_spark_config->recalc_accel_ratio;
+  *(cpba + ((FS_ETPU_SPARK_OFFSET_RECALC_LEAD_TIME      - 1)>>2)) = p_spark_config->recalc_lead_time;
+  *(cpba + ((FS_ETPU_SPARK_OFFSET_ANGLE_OFFSET_RECALC_MIN - 1)>>2)) = p_spark_config->angle_offset_recalc_min;
+  *(cpba + ((FS_ETPU_SPARK_OFFSET_CRANKING_TOOTH_ANGLE  - 1)>>2)) = p_spark_config->cranking_tooth_angle;
+  *(cpba + ((FS_ETPU_SPARK_OFFSET_CRANKING_DELAY        - 1)>>2)) = p_spark_config->cranking_delay;
+  *(cpba + ((FS_ETPU_SPARK_OFFSET_CRANKING_TOOTH_PERIOD - 1)>>2)) = p_spark_config->cranking_tooth_period;
+  *(cpba + ((FS_ETPU_SPARK_OFFSET_LATENESS_BUCKET_TIME  - 1)>>2)) = p_spark_config->lateness_bucket_time;
+  for(i=0; i<FS_ETPU_LATENESS_BUCKET_COUNT; i++)
+  {
+    *(cpba + ((FS_ETPU_SPARK_OFFSET_LATENESS_HIST - 1)>>2) + i) = 0;
+  }
   /* 8-bit */
   *((uint8_t*)cpba + FS_ETPU_SPARK_OFFSET_SPARK_COUNT        ) = spark_count;
   *((uint8_t*)cpba + FS_ETPU_SPARK_OFFSET_SPARK_COUNTER      ) = 0;
@@ -163,6 +180,7 @@ uint32_t fs_etpu_spark_init(
   *((uint8_t*)cpba + FS_ETPU_SPARK_OFFSET_STATE              ) = 0;
   *((uint8_t*)cpba + FS_ETPU_SPARK_OFFSET_ERROR              ) = 0;
   *((uint8_t*)cpba + FS_ETPU_SPARK_OFFSET_GENERATION_DISABLE ) = p_spark_config->generation_disable;
+  *((uint8_t*)cpba + FS_ETPU_SPARK_OFFSET_RECALC_COUNT_MAX   ) = p_spark_config->recalc_count_max;
 
   /* Write array of single sparke array parameters */
   p_single_spark_config = p_spark_config->p_single_spark_config;
@@ -243,9 +261,17 @@ uint32_t fs_etpu_spark_config(
     *(cpbae + ((FS_ETPU_SPARK_OFFSET_DWELL_TIME_MAX      - 1)>>2)) = p_spark_config->dwell_time_max;
     *(cpbae + ((FS_ETPU_SPARK_OFFSET_MULTI_ON_TIME       - 1)>>2)) = p_spark_config->multi_on_time;
     *(cpbae + ((FS_ETPU_SPARK_OFFSET_MULTI_OFF_TIME      - 1)>>2)) = p_spark_config->multi_off_time;
+    *(cpbae + ((FS_ETPU_SPARK_OFFSET_RECALC_ACCEL_RATIO    - 1)>>2)) = p_spark_config->recalc_accel_ratio;
+    *(cpbae + ((FS_ETPU_SPARK_OFFSET_RECALC_LEAD_TIME      - 1)>>2)) = p_spark_config->recalc_lead_time;
+    *(cpbae + ((FS_ETPU_SPARK_OFFSET_ANGLE_OFFSET_RECALC_MIN - 1)>>2)) = p_spark_config->angle_offset_recalc_min;
+    *(cpbae + ((FS_ETPU_SPARK_OFFSET_CRANKING_TOOTH_ANGLE  - 1)>>2)) = p_spark_config->cranking_tooth_angle;
+    *(cpbae + ((FS_ETPU_SPARK_OFFSET_CRANKING_DELAY        - 1)>>2)) = p_spark_config->cranking_delay;
+    *(cpbae + ((FS_ETPU_SPARK_OFFSET_CRANKING_TOOTH_PERIOD - 1)>>2)) = p_spark_config->cranking_tooth_period;
+    *(cpbae + ((FS_ETPU_SPARK_OFFSET_LATENESS_BUCKET_TIME  - 1)>>2)) = p_spark_config->lateness_bucket_time;
     /* 8-bit */
     *((uint8_t*)cpba + FS_ETPU_SPARK_OFFSET_SPARK_COUNT       ) = spark_count;
     *((uint8_t*)cpba + FS_ETPU_SPARK_OFFSET_GENERATION_DISABLE) = p_spark_config->generation_disable;
+    *((uint8_t*)cpba + FS_ETPU_SPARK_OFFSET_RECALC_COUNT_MAX  ) = p_spark_config->recalc_count_max;
 
     /* Write array of sparkection parameters */
     p_single_spark_config = p_spark_config->p_single_spark_config;
@@ -277,6 +303,7 @@ uint32_t fs_etpu_spark_config(
 * @note    The following actions are performed in order:
 *          -# Read state parameter values from eTPU DATA RAM
 *          -# Clear SPARK error
+*          -# Accumulate the lateness histogram counts
 *
 * @param   *p_spark_instance - This is a pointer to the instance structure
 *            @ref inj_instance_t.
@@ -293,6 +320,8 @@ uint32_t fs_etpu_spark_get_states(
 {
   uint32_t *cpba;
   uint32_t *cpbae;
+  uint32_t count;
+  uint8_t  i;
 
   cpba  = p_spark_instance->cpba;
   cpbae = cpba + (0x4000 >> 2); /* sign-extended memory area */
@@ -302,6 +331,14 @@ uint32_t fs_etpu_spark_get_states(
   p_spark_states->error             |= *((uint8_t*)cpba + FS_ETPU_SPARK_OFFSET_ERROR);
   /* Clear SPARK error */
   *((uint8_t*)cpba + FS_ETPU_SPARK_OFFSET_ERROR) = 0;
+  /* Accumulate the increments of the free-running lateness histogram */
+  for(i=0; i<FS_ETPU_LATENESS_BUCKET_COUNT; i++)
+  {
+    count = 0x00FFFFFF & *(cpba + ((FS_ETPU_SPARK_OFFSET_LATENESS_HIST - 1)>>2) + i);
+    p_spark_states->lateness_hist[i] +=
+      0x00FFFFFF & (count - p_spark_states->lateness_hist_last[i]);
+    p_spark_states->lateness_hist_last[i] = count;
+  }
 
   return(FS_ETPU_ERROR_NONE);
 }
@@ -341,6 +378,16 @@ uint32_t fs_etpu_spark_get_states(
  *
  * FILE OWNER: Milan Brejl [r54529]
  *
+ * Revision 1.3  2026/10/18
+ * Addition of lateness_bucket_time and lateness_hist.
+ *
+ * Revision 1.2  2026/10/18
+ * Addition of recalc_count_max, recalc_accel_ratio, recalc_lead_time and
+ * angle_offset_recalc_min.
+ *
+ * Revision 1.1  2026/10/18
+ * Addition of cranking mode parameters.
+ *
  * Revision 1.0  2014/03/17  r54529
  * Minor comment and formating improvements.
  * Ready for eTPU Engine Control Library release 1.0.
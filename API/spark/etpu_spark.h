@@ -67,7 +67,9 @@ struct spark_config_t
     according to the actual engine speed and end_angle. The calculation is
     repeated once again in order to adjust to a speed change at a defined
     angular position before the originaly calculated start_angle. This position
-    is given by angle_offset_recalc. */
+    is given by angle_offset_recalc.
+    If recalc_lead_time is set, angle_offset_recalc is the maximum
+    recalculation offset angle. */
   uint24_t dwell_time_min;  /**< The minimum spark dwell time as a number of
     TCR1 ticks. */
   uint24_t dwell_time_max;  /**< The maximum spark dwell time as a number of
@@ -83,6 +85,41 @@ struct spark_config_t
     the generation of output pulses. It can be assigned one of the values:
     - @ref FS_ETPU_SPARK_GENERATION_ALLOWED
     - @ref FS_ETPU_SPARK_GENERATION_DISABLED */
+  uint8_t  recalc_count_max;  /**< The maximum count of extra start angle
+    recalculations. An extra recalculation is done, at a quarter of the
+    previous recalculation offset before the start angle, only while the tooth
+    period changes by recalc_accel_ratio or more from tooth to tooth.
+    Set recalc_count_max = 0 to use no extra recalculation. */
+  ufract24_t recalc_accel_ratio;  /**< The tooth period change, as a fraction
+    of the tooth period, which triggers an extra start angle recalculation.
+    Set recalc_accel_ratio = 0 to do recalc_count_max extra recalculations
+    always. */
+  uint24_t recalc_lead_time;  /**< The optional recalculation lead time as
+    a number of TCR1 ticks. If set, the recalculation offset angle is not
+    fixed: the lead time is converted to angle using the actual engine speed
+    every cycle and bounded by angle_offset_recalc_min and angle_offset_recalc.
+    This keeps the time between the recalculation and the start angle constant
+    over the engine speed range. Set recalc_lead_time = 0 to use the fixed
+    angle_offset_recalc. */
+   int24_t angle_offset_recalc_min;  /**< The minimum recalculation offset
+    angle as a number of TCR2 ticks, used with recalc_lead_time. */
+   int24_t cranking_tooth_angle;  /**< The tdc_angle-relative angle of the
+    reference crank tooth edge as a number of TCR2 ticks. It must be a tooth
+    boundary angle preceding the spark end. In cranking mode, the spark main
+    pulse end is timed from this tooth edge instead of the end_angle. */
+  uint24_t cranking_delay;  /**< The time from the reference tooth edge to the
+    spark main pulse end as a number of TCR1 ticks, used in cranking mode. */
+  uint24_t cranking_tooth_period;  /**< The cranking speed threshold as
+    a crank tooth period in TCR1 ticks. The cranking mode is applied while
+    the tooth period is longer, the normal end_angle timing is used above
+    the cranking speed. Set cranking_tooth_period = 0 to disable the cranking
+    mode. */
+  uint24_t lateness_bucket_time;  /**< The output edge lateness histogram
+    bucket time as a number of TCR1 ticks. The lateness of each output edge
+    service is counted in one of FS_ETPU_LATENESS_BUCKET_COUNT buckets:
+    below lateness_bucket_time, below 4x, below 16x, and above (including
+    edges which were already in the past when scheduled).
+    Set lateness_bucket_time = 0 to disable the histogram. */
 };
 
 /** A structure to represent a single spark configuration. */
@@ -109,6 +146,14 @@ struct spark_states_t
         uint24_t dwell_time_applied;  /**< This is the last spark dwell-time
     actually generated. The value corresponds to commanded dwell_time, but
     it may slightly differ in case of rapid acceleration or deceleration. */
+  uint32_t lateness_hist[FS_ETPU_LATENESS_BUCKET_COUNT];  /**< The output
+    edge lateness histogram - counts of output edges per lateness bucket,
+    see lateness_bucket_time. The eTPU counters are free-running, the CPU
+    accumulates their increments since the last reading. */
+  uint24_t lateness_hist_last[FS_ETPU_LATENESS_BUCKET_COUNT];  /**< The eTPU
+    lateness histogram counter values at the last reading, used internally.
+    Clear it together with lateness_hist when the channel is initialized
+    again. */
 };
 
 /*******************************************************************************
@@ -165,6 +210,16 @@ uint32_t fs_etpu_spark_get_states(
  *
  * FILE OWNER: Milan Brejl [r54529]
  *
+ * Revision 1.3  2026/10/18
+ * Addition of lateness_bucket_time and lateness_hist.
+ *
+ * Revision 1.2  2026/10/18
+ * Addition of recalc_count_max, recalc_accel_ratio, recalc_lead_time and
+ * angle_offset_recalc_min.
+ *
+ * Revision 1.1  2026/10/18
+ * Addition of cranking mode parameters.
+ *
  * Revision 1.0  2014/03/17  r54529
  * Minor comment and formating improvements.
  * Ready for eTPU Engine Control Library release 1.0.
@@ -82,6 +82,16 @@ struct etpu_config_t{
   uint32_t wdtr_b;
 };
 
+/* Coherent transfer of a parameter pair - see fs_etpu_coherent_batch */
+struct fs_etpu_coherent_pair_t{
+  uint8_t  channel;   /* eTPU channel number */
+  uint8_t  mode;      /* FS_ETPU_COHERENT_READ/WRITE_24/32 */
+  uint32_t offset1;   /* offset of the first variable */
+  uint32_t offset2;   /* offset of the second variable */
+  uint32_t value1;    /* first value to be written, or the value read */
+  uint32_t value2;    /* second value to be written, or the value read */
+};
+
 /*******************************************************************************
 * Function prototypes
 *******************************************************************************/
@@ -261,6 +271,11 @@ uint32_t fs_etpu_coherent_write_32(
   uint32_t offset2,
   uint32_t value1,
   uint32_t value2);
+uint32_t fs_etpu_coherent_init(void);
+uint32_t fs_etpu_coherent_batch(
+  uint8_t context,
+  struct fs_etpu_coherent_pair_t *p_pairs,
+  uint8_t count);
 
 /* eTPU Load Evaluation */
 uint24_t fs_etpu_get_idle_cnt_a(void);
@@ -268,6 +283,20 @@ uint24_t fs_etpu_get_idle_cnt_b(void);
 void fs_etpu_clear_idle_cnt_a(void);
 void fs_etpu_clear_idle_cnt_b(void);
 
+/* eTPU Watchdog */
+void fs_etpu_set_watchdog_a(
+  uint32_t mode,
+  uint32_t count);
+void fs_etpu_set_watchdog_b(
+  uint32_t mode,
+  uint32_t count);
+uint32_t fs_etpu_get_watchdog_status_a(void);
+uint32_t fs_etpu_get_watchdog_status_b(void);
+void fs_etpu_clear_watchdog_status_a(
+  uint32_t mask);
+void fs_etpu_clear_watchdog_status_b(
+  uint32_t mask);
+
 /* Others */
 uint32_t *fs_memcpy32(
   uint32_t *dest,
@@ -392,6 +421,7 @@ void fs_memset32(
 #define FS_ETPU_WDM_THREAD_LEN         0x80000000 /* eTPU2 only */
 #define FS_ETPU_WDM_BUSY_LEN           0xC0000000 /* eTPU2 only */
 
+#define FS_ETPU_WATCHDOG_COUNT_MAX     0x0000ffff
 #define FS_ETPU_WDTR_WDCNT(x)      ((x) & 0xFFFF) /* Watchdog Count - eTPU2 only */
 
 /* CxCR - Channel x Configuration Register */
@@ -420,6 +450,25 @@ void fs_memset32(
 #define FS_ETPU_ERROR_VIS_BIT_NOT_SET  5
 #define FS_ETPU_ERROR_ADDRESS          6
 #define FS_ETPU_ERROR_TIMING           7
+#define FS_ETPU_ERROR_UNINITIALIZED    8
+
+/* Coherent transfer execution contexts - each context has a dedicated 8-byte
+   CDC buffer reserved by fs_etpu_coherent_init */
+#ifndef FS_ETPU_CDC_CONTEXT_COUNT
+#define FS_ETPU_CDC_CONTEXT_COUNT      4
+#endif
+#define FS_ETPU_CDC_CONTEXT_BACKGROUND 0
+#define FS_ETPU_CDC_CONTEXT_ISR_1      1  /* interrupt priority level 1 */
+#define FS_ETPU_CDC_CONTEXT_ISR_2      2  /* interrupt priority level 2 */
+#define FS_ETPU_CDC_CONTEXT_ISR_3      3  /* interrupt priority level 3 */
+
+/* Coherent transfer modes */
+#define FS_ETPU_COHERENT_32            0x01  /* PWIDTH bit */
+#define FS_ETPU_COHERENT_WRITE         0x02  /* WR bit */
+#define FS_ETPU_COHERENT_READ_24       0x00
+#define FS_ETPU_COHERENT_READ_32       FS_ETPU_COHERENT_32
+#define FS_ETPU_COHERENT_WRITE_24      FS_ETPU_COHERENT_WRITE
+#define FS_ETPU_COHERENT_WRITE_32      (FS_ETPU_COHERENT_WRITE + FS_ETPU_COHERENT_32)
 
 #endif /* _ETPU_UTIL_H_ */
 /*******************************************************************************
@@ -457,6 +506,13 @@ void fs_memset32(
  *
  * FILE OWNER: Milan Brejl [r54529]
  *
+ * Revision 3.4  2026/10/18
+ * struct fs_etpu_coherent_pair_t, FS_ETPU_CDC_CONTEXT_x and
+ * FS_ETPU_COHERENT_x and FS_ETPU_ERROR_UNINITIALIZED added.
+ *
+ * Revision 3.3  2026/10/18
+ * fs_etpu_set_watchdog_a/b and fs_etpu_get/clear_watchdog_status_a/b added.
+ *
  * Revision 3.2  2014/03/21  r54529
  * fs_etpu_clear_chan_interrupt_flag and fs_etpu_clear_chan_dma_flag bug fix
  * - the overflow flag was cleared as well.
@@ -54,9 +54,14 @@
 *    - @ref fs_etpu_set_global_32, @ref fs_etpu_set_global_24, @ref fs_etpu_set_global_16, @ref fs_etpu_set_global_8
 *    - @ref fs_etpu_coherent_read_32, @ref fs_etpu_coherent_read_24
 *    - @ref fs_etpu_coherent_write_32, @ref fs_etpu_coherent_write_24
+*    - @ref fs_etpu_coherent_init, @ref fs_etpu_coherent_batch
 * -# eTPU Load Evaluation
 *    - @ref fs_etpu_get_idle_cnt_a, @ref fs_etpu_clear_idle_cnt_a (eTPU2-only)
 *    - @ref fs_etpu_get_idle_cnt_b, @ref fs_etpu_clear_idle_cnt_b (eTPU2-only)
+* -# eTPU Watchdog
+*    - @ref fs_etpu_set_watchdog_a, @ref fs_etpu_set_watchdog_b (eTPU2-only)
+*    - @ref fs_etpu_get_watchdog_status_a, @ref fs_etpu_clear_watchdog_status_a (eTPU2-only)
+*    - @ref fs_etpu_get_watchdog_status_b, @ref fs_etpu_clear_watchdog_status_b (eTPU2-only)
 * -# Others
 *    - @ref fs_memcpy32, @ref fs_memset32
 *
@@ -74,6 +79,10 @@ extern const uint32_t fs_etpu_data_ram_start;
 extern const uint32_t fs_etpu_data_ram_end;
 extern const uint32_t fs_etpu_data_ram_ext;
 
+/* Dedicated 8-byte CDC buffers of the coherent transfer contexts, reserved
+   by fs_etpu_coherent_init */
+static uint32_t *fs_etpu_cdc_buffers = 0;
+
 /*******************************************************************************
 * FUNCTION: fs_etpu_init
 ****************************************************************************//*!
@@ -1324,6 +1333,118 @@ void fs_etpu_clear_idle_cnt_b(void)
   eTPU->IDLE_B.B.ICLR = 1;
 }
 
+/*******************************************************************************
+* FUNCTION: fs_etpu_set_watchdog_a
+****************************************************************************//*!
+* @brief   This function configures the engine A Watchdog Timer.
+*
+* @note    The watchdog is disabled first, before the new mode is configured.
+*          In @ref FS_ETPU_WDM_THREAD_LEN mode, a thread longer than count
+*          microinstructions is aborted and the channel is reported in the
+*          Watchdog Status Register, see @ref fs_etpu_get_watchdog_status_a.
+*
+* @param   mode - The watchdog mode, one of:
+*          - @ref FS_ETPU_WDM_DISABLED
+*          - @ref FS_ETPU_WDM_THREAD_LEN
+*          - @ref FS_ETPU_WDM_BUSY_LEN
+* @param   count - The watchdog count, up to @ref FS_ETPU_WATCHDOG_COUNT_MAX.
+*
+* @warning This function is applicable to eTPU2 only.
+*******************************************************************************/
+void fs_etpu_set_watchdog_a(
+  uint32_t mode,
+  uint32_t count)
+{
+  eTPU->WDTR_A.R = 0;
+  eTPU->WDTR_A.R = mode | FS_ETPU_WDTR_WDCNT(count);
+}
+
+/*******************************************************************************
+* FUNCTION: fs_etpu_get_watchdog_status_a
+****************************************************************************//*!
+* @brief   This function returns the engine A Watchdog Status Register.
+*
+* @return  A 32-bit mask of engine A channels. Bit n is set when a thread
+*          of channel n was aborted by the watchdog.
+*
+* @warning This function is applicable to eTPU2 only.
+*******************************************************************************/
+uint32_t fs_etpu_get_watchdog_status_a(void)
+{
+  return( eTPU->WDSR_A.R );
+}
+
+/*******************************************************************************
+* FUNCTION: fs_etpu_clear_watchdog_status_a
+****************************************************************************//*!
+* @brief   This function clears the engine A Watchdog Status flags.
+*
+* @param   mask - A 32-bit mask of channels whose flags are cleared.
+*
+* @warning This function is applicable to eTPU2 only.
+*******************************************************************************/
+void fs_etpu_clear_watchdog_status_a(
+  uint32_t mask)
+{
+  eTPU->WDSR_A.R = mask;
+}
+
+/*******************************************************************************
+* FUNCTION: fs_etpu_set_watchdog_b
+****************************************************************************//*!
+* @brief   This function configures the engine B Watchdog Timer.
+*
+* @note    The watchdog is disabled first, before the new mode is configured.
+*          In @ref FS_ETPU_WDM_THREAD_LEN mode, a thread longer than count
+*          microinstructions is aborted and the channel is reported in the
+*          Watchdog Status Register, see @ref fs_etpu_get_watchdog_status_b.
+*
+* @param   mode - The watchdog mode, one of:
+*          - @ref FS_ETPU_WDM_DISABLED
+*          - @ref FS_ETPU_WDM_THREAD_LEN
+*          - @ref FS_ETPU_WDM_BUSY_LEN
+* @param   count - The watchdog count, up to @ref FS_ETPU_WATCHDOG_COUNT_MAX.
+*
+* @warning This function is applicable to eTPU2 only.
+*******************************************************************************/
+void fs_etpu_set_watchdog_b(
+  uint32_t mode,
+  uint32_t count)
+{
+  eTPU->WDTR_B.R = 0;
+  eTPU->WDTR_B.R = mode | FS_ETPU_WDTR_WDCNT(count);
+}
+
+/*******************************************************************************
+* FUNCTION: fs_etpu_get_watchdog_status_b
+****************************************************************************//*!
+* @brief   This function returns the engine B Watchdog Status Register.
+*
+* @return  A 32-bit mask of engine B channels. Bit n is set when a thread
+*          of channel n was aborted by the watchdog.
+*
+* @warning This function is applicable to eTPU2 only.
+*******************************************************************************/
+uint32_t fs_etpu_get_watchdog_status_b(void)
+{
+  return( eTPU->WDSR_B.R );
+}
+
+/*******************************************************************************
+* FUNCTION: fs_etpu_clear_watchdog_status_b
+****************************************************************************//*!
+* @brief   This function clears the engine B Watchdog Status flags.
+*
+* @param   mask - A 32-bit mask of channels whose flags are cleared.
+*
+* @warning This function is applicable to eTPU2 only.
+*******************************************************************************/
+void fs_etpu_clear_watchdog_status_b(
+  uint32_t mask)
+{
+  eTPU->WDSR_B.R = mask;
+}
+
 /*******************************************************************************
 * FUNCTION: fs_etpu_coherent_read_24
 ****************************************************************************//*!
@@ -1341,6 +1462,12 @@ void fs_etpu_clear_idle_cnt_b(void)
 *            memory for the temporally buffer in eTPU DATA RAM
 *          - @ref FS_ETPU_ERROR_ADDRESS - When the variable offsets do not allow
 *            the CDC operation.
+*
+* @warning Unless the CDC buffers are reserved by @ref fs_etpu_coherent_init,
+*          this function is non-reentrant and uses the @ref fs_etpu_free_param global
+*          as the temporary buffer. Otherwise it uses the background context
+*          buffer and must not be called from an interrupt - use
+*          @ref fs_etpu_coherent_batch there.
 *******************************************************************************/
 uint32_t fs_etpu_coherent_read_24(
   uint8_t channel,
@@ -1351,10 +1478,15 @@ uint32_t fs_etpu_coherent_read_24(
 {
   uint32_t addr1, addr2, ctbase1, ctbase2;
   uint32_t addr_b;
+  uint32_t *buffer;
   uint32_t err_code = 0;
 
+  /* use the background context CDC buffer if reserved, otherwise the first
+     free parameter */
+  buffer = (fs_etpu_cdc_buffers != 0) ? fs_etpu_cdc_buffers : fs_etpu_free_param;
+
   /* check there is a DATA RAM space for the temporally buffer */
-  if ((uint32_t)fs_etpu_free_param + 8 > fs_etpu_data_ram_end)
+  if ((uint32_t)buffer + 8 > fs_etpu_data_ram_end)
   {
     err_code = FS_ETPU_ERROR_MALLOC;
   }
@@ -1373,7 +1505,7 @@ uint32_t fs_etpu_coherent_read_24(
     else
     {
       /* SDM-relative doubleword address of buffer (8 byte granularity) */
-      addr_b = ((uint32_t)fs_etpu_free_param - fs_etpu_data_ram_start) >> 3;
+      addr_b = ((uint32_t)buffer - fs_etpu_data_ram_start) >> 3;
 
       /* CDC Register - configure and start the coherent transfer
            CTBASE = ctbase1;
@@ -1389,8 +1521,8 @@ uint32_t fs_etpu_coherent_read_24(
       /* now host receives wait states untill the transfer is done */
 
       /* read values from temporary buffer */
-      *value1 = ((*(fs_etpu_free_param))<<8)>>8;
-      *value2 = ((*(fs_etpu_free_param + 1))<<8)>>8;
+      *value1 = ((*(buffer))<<8)>>8;
+      *value2 = ((*(buffer + 1))<<8)>>8;
     }
   }
   return(err_code);
@@ -1413,6 +1545,12 @@ uint32_t fs_etpu_coherent_read_24(
 *            memory for the temporally buffer in eTPU DATA RAM
 *          - @ref FS_ETPU_ERROR_ADDRESS - When the variable offsets do not allow
 *            the CDC operation.
+*
+* @warning Unless the CDC buffers are reserved by @ref fs_etpu_coherent_init,
+*          this function is non-reentrant and uses the @ref fs_etpu_free_param global
+*          as the temporary buffer. Otherwise it uses the background context
+*          buffer and must not be called from an interrupt - use
+*          @ref fs_etpu_coherent_batch there.
 *******************************************************************************/
 uint32_t fs_etpu_coherent_read_32(
   uint8_t channel,
@@ -1423,10 +1561,15 @@ uint32_t fs_etpu_coherent_read_32(
 {
   uint32_t addr1, addr2, ctbase1, ctbase2;
   uint32_t addr_b;
+  uint32_t *buffer;
   uint32_t err_code = 0;
 
+  /* use the background context CDC buffer if reserved, otherwise the first
+     free parameter */
+  buffer = (fs_etpu_cdc_buffers != 0) ? fs_etpu_cdc_buffers : fs_etpu_free_param;
+
   /* check there is a DATA RAM space for the temporally buffer */
-  if ((uint32_t)fs_etpu_free_param + 8 > fs_etpu_data_ram_end)
+  if ((uint32_t)buffer + 8 > fs_etpu_data_ram_end)
   {
     err_code = FS_ETPU_ERROR_MALLOC;
   }
@@ -1445,7 +1588,7 @@ uint32_t fs_etpu_coherent_read_32(
     else
     {
       /* SDM-relative doubleword address of buffer (8 byte granularity) */
-      addr_b = ((uint32_t)fs_etpu_free_param - fs_etpu_data_ram_start) >> 3;
+      addr_b = ((uint32_t)buffer - fs_etpu_data_ram_start) >> 3;
 
       /* CDC Register - configure and start the coherent transfer
            CTBASE = ctbase1;
@@ -1461,8 +1604,8 @@ uint32_t fs_etpu_coherent_read_32(
       /* now host receives wait states untill the transfer is done */
 
       /* read values from temporary buffer */
-      *value1 = *(fs_etpu_free_param);
-      *value2 = *(fs_etpu_free_param + 1);
+      *value1 = *(buffer);
+      *value2 = *(buffer + 1);
     }
   }
   return(err_code);
@@ -1485,6 +1628,12 @@ uint32_t fs_etpu_coherent_read_32(
 *            memory for the temporally buffer in eTPU DATA RAM
 *          - @ref FS_ETPU_ERROR_ADDRESS - When the variable offsets do not allow
 *            the CDC operation.
+*
+* @warning Unless the CDC buffers are reserved by @ref fs_etpu_coherent_init,
+*          this function is non-reentrant and uses the @ref fs_etpu_free_param global
+*          as the temporary buffer. Otherwise it uses the background context
+*          buffer and must not be called from an interrupt - use
+*          @ref fs_etpu_coherent_batch there.
 *******************************************************************************/
 uint32_t fs_etpu_coherent_write_24(
   uint8_t channel,
@@ -1495,18 +1644,23 @@ uint32_t fs_etpu_coherent_write_24(
 {
   uint32_t addr1, addr2, ctbase1, ctbase2;
   uint32_t addr_b;
+  uint32_t *buffer;
   uint32_t err_code = 0;
 
+  /* use the background context CDC buffer if reserved, otherwise the first
+     free parameter */
+  buffer = (fs_etpu_cdc_buffers != 0) ? fs_etpu_cdc_buffers : fs_etpu_free_param;
+
   /* check there is a DATA RAM space for the temporally buffer */
-  if ((uint32_t)fs_etpu_free_param + 8 > fs_etpu_data_ram_end)
+  if ((uint32_t)buffer + 8 > fs_etpu_data_ram_end)
   {
     err_code = FS_ETPU_ERROR_MALLOC;
   }
   else
   {
     /* write values to the temporary buffer */
-    *(fs_etpu_free_param) = value1;
-    *(fs_etpu_free_param + 1) = value2;
+    *(buffer) = value1;
+    *(buffer + 1) = value2;
 
     /* SDM-relative word addresses of parameters (4 byte granularity) */
     addr1 = ((eTPU->CHAN[channel].CR.B.CPBA << 3) + offset1 - 1) >> 2;
@@ -1521,7 +1675,7 @@ uint32_t fs_etpu_coherent_write_24(
     else
     {
       /* SDM-relative doubleword address of buffer (8 byte granularity) */
-      addr_b = ((uint32_t)fs_etpu_free_param - fs_etpu_data_ram_start) >> 3;
+      addr_b = ((uint32_t)buffer - fs_etpu_data_ram_start) >> 3;
 
       /* CDC Register - configure and start the coherent transfer
            CTBASE = ctbase1;
@@ -1558,6 +1712,12 @@ uint32_t fs_etpu_coherent_write_24(
 *            memory for the temporally buffer in eTPU DATA RAM
 *          - @ref FS_ETPU_ERROR_ADDRESS - When the variable offsets do not allow
 *            the CDC operation.
+*
+* @warning Unless the CDC buffers are reserved by @ref fs_etpu_coherent_init,
+*          this function is non-reentrant and uses the @ref fs_etpu_free_param global
+*          as the temporary buffer. Otherwise it uses the background context
+*          buffer and must not be called from an interrupt - use
+*          @ref fs_etpu_coherent_batch there.
 *******************************************************************************/
 uint32_t fs_etpu_coherent_write_32(
   uint8_t channel,
@@ -1568,18 +1728,23 @@ uint32_t fs_etpu_coherent_write_32(
 {
   uint32_t addr1, addr2, ctbase1, ctbase2;
   uint32_t addr_b;
+  uint32_t *buffer;
   uint32_t err_code = 0;
 
+  /* use the background context CDC buffer if reserved, otherwise the first
+     free parameter */
+  buffer = (fs_etpu_cdc_buffers != 0) ? fs_etpu_cdc_buffers : fs_etpu_free_param;
+
   /* check there is a DATA RAM space for the temporally buffer */
-  if ((uint32_t)fs_etpu_free_param + 8 > fs_etpu_data_ram_end)
+  if ((uint32_t)buffer + 8 > fs_etpu_data_ram_end)
   {
     err_code = FS_ETPU_ERROR_MALLOC;
   }
   else
   {
     /* write values to the temporary buffer */
-    *(fs_etpu_free_param) = value1;
-    *(fs_etpu_free_param + 1) = value2;
+    *(buffer) = value1;
+    *(buffer + 1) = value2;
 
     /* SDM-relative word addresses of parameters (4 byte granularity) */
     addr1 = ((eTPU->CHAN[channel].CR.B.CPBA << 3) + offset1) >> 2;
@@ -1594,7 +1759,7 @@ uint32_t fs_etpu_coherent_write_32(
     else
     {
       /* SDM-relative doubleword address of buffer (8 byte granularity) */
-      addr_b = ((uint32_t)fs_etpu_free_param - fs_etpu_data_ram_start) >> 3;
+      addr_b = ((uint32_t)buffer - fs_etpu_data_ram_start) >> 3;
 
       /* CDC Register - configure and start the coherent transfer
            CTBASE = ctbase1;
@@ -1614,6 +1779,149 @@ uint32_t fs_etpu_coherent_write_32(
   return(err_code);
 }
 
+/*******************************************************************************
+* FUNCTION: fs_etpu_coherent_init
+****************************************************************************//*!
+* @brief   This function reserves the dedicated 8-byte CDC buffers of all
+*          coherent transfer contexts in eTPU DATA RAM.
+*
+* @note    Each execution context (background and each interrupt priority
+*          level) gets its own buffer, so coherent transfers can preempt each
+*          other and later @ref fs_etpu_malloc calls cannot overwrite a buffer
+*          in use. The number of contexts is @ref FS_ETPU_CDC_CONTEXT_COUNT.
+*
+* @return  Zero or an error code. Error codes that can be returned are:
+*          - @ref FS_ETPU_ERROR_MALLOC - When there is not enough available
+*            memory for the buffers in eTPU DATA RAM
+*
+* @warning This function should be called once, after @ref fs_etpu_init
+*          (and @ref fs_etpu2_init), before any coherent transfer is used
+*          from an interrupt. It is non-reentrant and uses @ref fs_etpu_malloc.
+*******************************************************************************/
+uint32_t fs_etpu_coherent_init(void)
+{
+  uint32_t *buffers;
+
+  if(fs_etpu_cdc_buffers == 0)
+  {
+    buffers = fs_etpu_malloc(FS_ETPU_CDC_CONTEXT_COUNT << 3);
+    if(buffers == 0) return(FS_ETPU_ERROR_MALLOC);
+    fs_etpu_cdc_buffers = buffers;
+  }
+  return(FS_ETPU_ERROR_NONE);
+}
+
+/*******************************************************************************
+* FUNCTION: fs_etpu_coherent_batch
+****************************************************************************//*!
+* @brief   This function performs a list of coherent transfers of parameter
+*          pairs back-to-back, using the Coherent Dual-Parameter Controller
+*          (CDC) and the CDC buffer dedicated to the calling context.
+*
+* @note    All pairs are checked before the first transfer is started, so
+*          either all or none of the transfers are performed. Each pair is
+*          transferred coherently, the list as a whole is not.
+*          Pair modes:
+*          - @ref FS_ETPU_COHERENT_READ_24 - values 23:0 are read, bits 31:24
+*            are cleared as in @ref fs_etpu_coherent_read_24
+*          - @ref FS_ETPU_COHERENT_READ_32 - values are read
+*          - @ref FS_ETPU_COHERENT_WRITE_24 - values 23:0 are written
+*          - @ref FS_ETPU_COHERENT_WRITE_32 - values are written
+*
+* @param   context - The calling execution context, one of
+*          @ref FS_ETPU_CDC_CONTEXT_BACKGROUND, @ref FS_ETPU_CDC_CONTEXT_ISR_1,
+*          ... (the interrupt priority level). Contexts which can preempt
+*          each other must use different buffers.
+* @param   *p_pairs - Pointer to the list of pairs. Read values are stored
+*          into the value1 and value2 members.
+* @param   count - The number of pairs in the list.
+*
+* @return  Zero or an error code. Error codes that can be returned are:
+*          - @ref FS_ETPU_ERROR_UNINITIALIZED - When the CDC buffers were not
+*            reserved by @ref fs_etpu_coherent_init
+*          - @ref FS_ETPU_ERROR_VALUE - When the context or a pair mode is out
+*            of range
+*          - @ref FS_ETPU_ERROR_ADDRESS - When the variable offsets of a pair
+*            do not allow the CDC operation.
+*******************************************************************************/
+uint32_t fs_etpu_coherent_batch(
+  uint8_t context,
+  struct fs_etpu_coherent_pair_t *p_pairs,
+  uint8_t count)
+{
+  struct fs_etpu_coherent_pair_t *p_pair;
+  uint32_t addr1, addr2, ctbase1, ctbase2;
+  uint32_t cpba, offset_adj;
+  uint32_t addr_b;
+  uint32_t *buffer;
+  uint8_t  i;
+
+  if(fs_etpu_cdc_buffers == 0) return(FS_ETPU_ERROR_UNINITIALIZED);
+  if(context >= FS_ETPU_CDC_CONTEXT_COUNT) return(FS_ETPU_ERROR_VALUE);
+
+  /* check all pairs first */
+  for(i = 0, p_pair = p_pairs; i < count; i++, p_pair++)
+  {
+    if(p_pair->mode > FS_ETPU_COHERENT_WRITE_32) return(FS_ETPU_ERROR_VALUE);
+
+    /* 24-bit variables are addressed by the byte preceding them */
+    offset_adj = (p_pair->mode & FS_ETPU_COHERENT_32) ? 0 : 1;
+    cpba = eTPU->CHAN[p_pair->channel].CR.B.CPBA << 3;
+    ctbase1 = ((cpba + p_pair->offset1 - offset_adj) >> 2) >> 7;
+    ctbase2 = ((cpba + p_pair->offset2 - offset_adj) >> 2) >> 7;
+    if(ctbase1 != ctbase2) return(FS_ETPU_ERROR_ADDRESS);
+  }
+
+  /* SDM-relative doubleword address of the context buffer */
+  buffer = fs_etpu_cdc_buffers + (context << 1);
+  addr_b = ((uint32_t)buffer - fs_etpu_data_ram_start) >> 3;
+
+  for(i = 0, p_pair = p_pairs; i < count; i++, p_pair++)
+  {
+    if(p_pair->mode & FS_ETPU_COHERENT_WRITE)
+    {
+      /* write values to the temporary buffer */
+      *(buffer) = p_pair->value1;
+      *(buffer + 1) = p_pair->value2;
+    }
+
+    /* SDM-relative word addresses of parameters (4 byte granularity) */
+    offset_adj = (p_pair->mode & FS_ETPU_COHERENT_32) ? 0 : 1;
+    cpba = eTPU->CHAN[p_pair->channel].CR.B.CPBA << 3;
+    addr1 = (cpba + p_pair->offset1 - offset_adj) >> 2;
+    addr2 = (cpba + p_pair->offset2 - offset_adj) >> 2;
+
+    /* CDC Register - configure and start the coherent transfer
+         CTBASE = addr1 >> 7;
+         PARAM0 = addr1 & 0x7F;
+         PARAM1 = addr2 & 0x7F;
+         PBASE  = addr_b;
+         WR     = mode bit 1;
+         PWIDTH = mode bit 0;
+         STS    = 1;  - start */
+    eTPU->CDCR.R = (1<<31) + ((addr1 >> 7)<<26) + (addr_b<<16)
+                   + ((p_pair->mode & FS_ETPU_COHERENT_32)<<15)
+                   + ((p_pair->mode & FS_ETPU_COHERENT_WRITE)<<6)
+                   + ((addr1 & 0x7F)<<8) + (addr2 & 0x7F);
+
+    /* now host receives wait states untill the transfer is done */
+
+    if(p_pair->mode == FS_ETPU_COHERENT_READ_24)
+    {
+      /* read values 23:0 from temporary buffer */
+      p_pair->value1 = *(buffer) & 0x00FFFFFF;
+      p_pair->value2 = *(buffer + 1) & 0x00FFFFFF;
+    }
+    else if(p_pair->mode == FS_ETPU_COHERENT_READ_32)
+    {
+      /* read values from temporary buffer */
+      p_pair->value1 = *(buffer);
+      p_pair->value2 = *(buffer + 1);
+    }
+  }
+  return(FS_ETPU_ERROR_NONE);
+}
+
 /*******************************************************************************
  *
  * Copyright:
@@ -1649,6 +1957,13 @@ uint32_t fs_etpu_coherent_write_32(
  *
  * FILE OWNER: Milan Brejl [r54529]
  * 
+ * Revision 3.4  2026/10/18
+ * fs_etpu_coherent_init and fs_etpu_coherent_batch added - dedicated CDC
+ * buffers per execution context and batched coherent transfers.
+ *
+ * Revision 3.3  2026/10/18
+ * fs_etpu_set_watchdog_a/b and fs_etpu_get/clear_watchdog_status_a/b added.
+ *
  * Revision 3.2  2014/03/21  r54529
  * fs_etpu_clear_chan_interrupt_flag and fs_etpu_clear_chan_dma_flag bug fix
  * - the overflow flag was cleared as well.
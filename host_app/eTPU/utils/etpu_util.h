@@ -97,6 +97,16 @@ struct etpu_config_t{
   uint32_t scmoff;
 };
 
+/* Coherent transfer of a parameter pair - see fs_etpu_coherent_batch */
+struct fs_etpu_coherent_pair_t{
+  uint8_t  channel;   /* eTPU channel number */
+  uint8_t  mode;      /* FS_ETPU_COHERENT_READ/WRITE_24/32 */
+  uint32_t offset1;   /* offset of the first variable */
+  uint32_t offset2;   /* offset of the second variable */
+  uint32_t value1;    /* first value to be written, or the value read */
+  uint32_t value2;    /* second value to be written, or the value read */
+};
+
 /*******************************************************************************
 * Function prototypes
 *******************************************************************************/
@@ -278,6 +288,11 @@ uint32_t fs_etpu_coherent_write_32(
   uint32_t offset2,
   uint32_t value1,
   uint32_t value2);
+uint32_t fs_etpu_coherent_init(void);
+uint32_t fs_etpu_coherent_batch(
+  uint8_t context,
+  struct fs_etpu_coherent_pair_t *p_pairs,
+  uint8_t count);
 
 /* eTPU Load Evaluation */
 uint24_t fs_etpu_get_idle_cnt_a(void);
@@ -285,6 +300,20 @@ uint24_t fs_etpu_get_idle_cnt_b(void);
 void fs_etpu_clear_idle_cnt_a(void);
 void fs_etpu_clear_idle_cnt_b(void);
 
+/* eTPU Watchdog */
+void fs_etpu_set_watchdog_a(
+  uint32_t mode,
+  uint32_t count);
+void fs_etpu_set_watchdog_b(
+  uint32_t mode,
+  uint32_t count);
+uint32_t fs_etpu_get_watchdog_status_a(void);
+uint32_t fs_etpu_get_watchdog_status_b(void);
+void fs_etpu_clear_watchdog_status_a(
+  uint32_t mask);
+void fs_etpu_clear_watchdog_status_b(
+  uint32_t mask);
+
 /* Others */
 uint32_t *fs_memcpy32(
   uint32_t *dest,
@@ -445,6 +474,24 @@ void fs_memset32(
 #define FS_ETPU_ERROR_UNINITIALIZED    8
 #define FS_ETPU_ERROR_NOT_READY        9
 
+/* Coherent transfer execution contexts - each context has a dedicated 8-byte
+   CDC buffer reserved by fs_etpu_coherent_init */
+#ifndef FS_ETPU_CDC_CONTEXT_COUNT
+#define FS_ETPU_CDC_CONTEXT_COUNT      4
+#endif
+#define FS_ETPU_CDC_CONTEXT_BACKGROUND 0
+#define FS_ETPU_CDC_CONTEXT_ISR_1      1  /* interrupt priority level 1 */
+#define FS_ETPU_CDC_CONTEXT_ISR_2      2  /* interrupt priority level 2 */
+#define FS_ETPU_CDC_CONTEXT_ISR_3      3  /* interrupt priority level 3 */
+
+/* Coherent transfer modes */
+#define FS_ETPU_COHERENT_32            0x01  /* PWIDTH bit */
+#define FS_ETPU_COHERENT_WRITE         0x02  /* WR bit */
+#define FS_ETPU_COHERENT_READ_24       0x00
+#define FS_ETPU_COHERENT_READ_32       FS_ETPU_COHERENT_32
+#define FS_ETPU_COHERENT_WRITE_24      FS_ETPU_COHERENT_WRITE
+#define FS_ETPU_COHERENT_WRITE_32      (FS_ETPU_COHERENT_WRITE + FS_ETPU_COHERENT_32)
+
 #ifdef __cplusplus
 }
 #endif
@@ -485,6 +532,13 @@ void fs_memset32(
  *
  * FILE OWNER: Milan Brejl [r54529]
  *
+ * Revision 3.4  2026/10/18
+ * struct fs_etpu_coherent_pair_t, FS_ETPU_CDC_CONTEXT_x and
+ * FS_ETPU_COHERENT_x added.
+ *
+ * Revision 3.3  2026/10/18
+ * fs_etpu_set_watchdog_a/b and fs_etpu_get/clear_watchdog_status_a/b added.
+ *
  * Revision 3.2  2014/03/21  r54529
  * fs_etpu_clear_chan_interrupt_flag and fs_etpu_clear_chan_dma_flag bug fix
  * - the overflow flag was cleared as well.
@@ -51,6 +51,8 @@ const uint32_t etpu_tcr1_1000us = USEC2TCR1(1000);
 const uint32_t etpu_tcr2_720deg = DEG2TCR2(720);
 /** @brief   Enable FreeMaster to transform Tooth Period to Engine Speed */
 const uint32_t etpu_rpm2tp = TP2RPM(1);
+/** @brief   Enable FreeMaster to read the eTPU code image size in bytes */
+const uint32_t etpu_code_size = sizeof(etpu_code);
 
 /*******************************************************************************
  * Global eTPU settings - etpu_config structure
@@ -176,7 +178,12 @@ struct crank_config_t crank_config =
   UFRACT24(0.5), /* win_ratio_across_gap */
   UFRACT24(0.2), /* win_ratio_after_gap */
   UFRACT24(0.5), /* win_ratio_after_timeout */
-  MSEC2TCR1(50)  /* first_tooth_timeout */
+  MSEC2TCR1(50), /* first_tooth_timeout */
+  RPM2TRR(3000), /* trr_norm_highres */
+  /* stall prediction disabled - a ratio below win_ratio_normal also flags
+     the normal deceleration, tune it on the engine before enabling */
+  0,             /* stall_decel_ratio */
+  0              /* stall_decel_teeth */
 };
 
 struct crank_states_t crank_states;
@@ -191,12 +198,52 @@ struct cam_instance_t cam_instance =
   FS_ETPU_PRIORITY_LOW,  /* priority */
   CAM_LOG_SIZE,          /* log_size */ 
   0,                     /* *cpba */     /* 0 for automatic allocation */
-  0                      /* *cpba_log */ /* 0 for automatic allocation */
+  0,                     /* *cpba_log */ /* 0 for automatic allocation */
+  0,                     /* *cpba_windows */ /* 0 for automatic allocation */
+  0                      /* window_count_max */ /* set by fs_etpu_cam_init */
+};
+
+/* Expected Cam transitions in full sync - the TG cam_edge_teeth pattern,
+   +-15 degrees around each edge tooth */
+struct cam_window_config_t cam_window_config[6] =
+{
+  {
+    FS_ETPU_CAM_WINDOW_RISING,  /* trans */
+    DEG2TCR2(60-15),            /* angle_start */
+    DEG2TCR2(30)                /* angle_width */
+  },
+  {
+    FS_ETPU_CAM_WINDOW_FALLING, /* trans */
+    DEG2TCR2(120-15),           /* angle_start */
+    DEG2TCR2(30)                /* angle_width */
+  },
+  {
+    FS_ETPU_CAM_WINDOW_RISING,  /* trans */
+    DEG2TCR2(270-15),           /* angle_start */
+    DEG2TCR2(30)                /* angle_width */
+  },
+  {
+    FS_ETPU_CAM_WINDOW_FALLING, /* trans */
+    DEG2TCR2(510-15),           /* angle_start */
+    DEG2TCR2(30)                /* angle_width */
+  },
+  {
+    FS_ETPU_CAM_WINDOW_RISING,  /* trans */
+    DEG2TCR2(600-15),           /* angle_start */
+    DEG2TCR2(30)                /* angle_width */
+  },
+  {
+    FS_ETPU_CAM_WINDOW_FALLING, /* trans */
+    DEG2TCR2(660-15),           /* angle_start */
+    DEG2TCR2(30)                /* angle_width */
+  }
 };
 
 struct cam_config_t cam_config =
 {
-  FS_ETPU_CAM_LOG_BOTH /* mode */
+  FS_ETPU_CAM_LOG_BOTH,  /* mode */
+  0,                     /* window_count */  /* phase check disabled, 6 to enable */
+  &cam_window_config[0]  /* p_cam_window_config */
 };
 
 struct cam_states_t cam_states;
@@ -268,7 +315,15 @@ struct spark_config_t spark_config =
   USEC2TCR1(100),  /* multi_off_time */
   1,               /* spark_count */
   &single_spark_config[0],  /* p_single_spark_config */
-  FS_ETPU_SPARK_GENERATION_ALLOWED  /* generation_disable */
+  FS_ETPU_SPARK_GENERATION_ALLOWED, /* generation_disable */
+  2,               /* recalc_count_max */
+  UFRACT24(0.02),  /* recalc_accel_ratio */
+  USEC2TCR1(1500), /* recalc_lead_time */
+  DEG2TCR2(10),    /* angle_offset_recalc_min */
+  DEG2TCR2(10),    /* cranking_tooth_angle */
+  USEC2TCR1(1000), /* cranking_delay */
+  RPM2TP(400),     /* cranking_tooth_period */
+  USEC2TCR1(5)     /* lateness_bucket_time */
 };
 
 struct spark_states_t spark_1_states;
@@ -324,7 +379,16 @@ struct fuel_config_t fuel_config =
   USEC2TCR1(2000), /* injection_time */
   USEC2TCR1(1000),  /* compensation_time */
   USEC2TCR1(1000),  /* injection_time_minimum */
-  USEC2TCR1(1000)   /* off_time_minimum */
+  USEC2TCR1(1000),  /* off_time_minimum */
+  FS_ETPU_FUEL_GENERATION_ALLOWED, /* generation_disable */
+  FS_ETPU_FUEL_END_MODE_TIME, /* end_mode */
+  DEG2TCR2(1),      /* angle_end_tolerance */
+  UFRACT24(0.25),   /* end_time_deviation_max */
+  2,                /* recalc_count_max */
+  UFRACT24(0.02),   /* recalc_accel_ratio */
+  USEC2TCR1(1500),  /* recalc_lead_time */
+  DEG2TCR2(10),     /* angle_offset_recalc_min */
+  USEC2TCR1(5)      /* lateness_bucket_time */
 };
 
 struct fuel_states_t fuel_1_states;
@@ -445,7 +509,8 @@ struct inj_config_t inj_config =
   DEG2TCR2(90),            /* angle_irq */
   DEG2TCR2(-20),           /* angle_stop */
   3,                       /* injection_count */
-  &inj_injection_config[0] /* *p_inj_injection_config */
+  &inj_injection_config[0], /* *p_inj_injection_config */
+  USEC2TCR1(5)             /* lateness_bucket_time */
 };
 
 struct inj_states_t inj_1_states;
@@ -561,6 +626,7 @@ FMSTR_TSA_TABLE_BEGIN(fmstr_tsa_table_etpu_scaling)
     FMSTR_TSA_RO_VAR(etpu_tcr1_1000us, FMSTR_TSA_UINT32)
     FMSTR_TSA_RO_VAR(etpu_tcr2_720deg, FMSTR_TSA_UINT32)
     FMSTR_TSA_RO_VAR(etpu_rpm2tp, FMSTR_TSA_UINT32)
+    FMSTR_TSA_RO_VAR(etpu_code_size, FMSTR_TSA_UINT32)
 FMSTR_TSA_TABLE_END()
 
 FMSTR_TSA_TABLE_BEGIN(fmstr_tsa_table_crank)
@@ -596,6 +662,9 @@ FMSTR_TSA_TABLE_BEGIN(fmstr_tsa_table_crank)
     FMSTR_TSA_MEMBER(struct crank_config_t, win_ratio_after_gap, FMSTR_TSA_UINT32)
     FMSTR_TSA_MEMBER(struct crank_config_t, win_ratio_after_timeout, FMSTR_TSA_UINT32)
     FMSTR_TSA_MEMBER(struct crank_config_t, first_tooth_timeout, FMSTR_TSA_UINT32)
+    FMSTR_TSA_MEMBER(struct crank_config_t, trr_norm_highres, FMSTR_TSA_UINT32)
+    FMSTR_TSA_MEMBER(struct crank_config_t, stall_decel_ratio, FMSTR_TSA_UINT32)
+    FMSTR_TSA_MEMBER(struct crank_config_t, stall_decel_teeth, FMSTR_TSA_UINT8)
     FMSTR_TSA_STRUCT(struct crank_states_t)
     FMSTR_TSA_MEMBER(struct crank_states_t, error, FMSTR_TSA_UINT8)
     FMSTR_TSA_MEMBER(struct crank_states_t, state, FMSTR_TSA_UINT8)
@@ -603,11 +672,14 @@ FMSTR_TSA_TABLE_BEGIN(fmstr_tsa_table_crank)
     FMSTR_TSA_MEMBER(struct crank_states_t, tooth_counter_gap, FMSTR_TSA_UINT8)
     FMSTR_TSA_MEMBER(struct crank_states_t, tooth_counter_cycle, FMSTR_TSA_UINT8)
     FMSTR_TSA_MEMBER(struct crank_states_t, last_tooth_period, FMSTR_TSA_UINT32)
+    FMSTR_TSA_MEMBER(struct crank_states_t, tooth_latency_max, FMSTR_TSA_UINT32)
+    FMSTR_TSA_MEMBER(struct crank_states_t, stall_predicted_count, FMSTR_TSA_UINT8)
 FMSTR_TSA_TABLE_END()
 
 FMSTR_TSA_TABLE_BEGIN(fmstr_tsa_table_cam)
     FMSTR_TSA_RO_VAR(cam_instance, FMSTR_TSA_USERTYPE(struct cam_instance_t))
     FMSTR_TSA_RW_VAR(cam_config, FMSTR_TSA_USERTYPE(struct cam_config_t))
+    FMSTR_TSA_RW_VAR(cam_window_config, FMSTR_TSA_USERTYPE(struct cam_window_config_t))
     FMSTR_TSA_RO_VAR(cam_states, FMSTR_TSA_USERTYPE(struct cam_states_t))
     
     FMSTR_TSA_STRUCT(struct cam_instance_t)
@@ -616,8 +688,16 @@ FMSTR_TSA_TABLE_BEGIN(fmstr_tsa_table_cam)
     FMSTR_TSA_MEMBER(struct cam_instance_t, log_size, FMSTR_TSA_UINT8)
     FMSTR_TSA_MEMBER(struct cam_instance_t, cpba, FMSTR_TSA_UINT32)
     FMSTR_TSA_MEMBER(struct cam_instance_t, cpba_log, FMSTR_TSA_UINT32)
+    FMSTR_TSA_MEMBER(struct cam_instance_t, cpba_windows, FMSTR_TSA_UINT32)
+    FMSTR_TSA_MEMBER(struct cam_instance_t, window_count_max, FMSTR_TSA_UINT8)
     FMSTR_TSA_STRUCT(struct cam_config_t)
     FMSTR_TSA_MEMBER(struct cam_config_t, mode, FMSTR_TSA_UINT8)
+    FMSTR_TSA_MEMBER(struct cam_config_t, window_count, FMSTR_TSA_UINT8)
+    FMSTR_TSA_MEMBER(struct cam_config_t, p_cam_window_config, FMSTR_TSA_UINT32)
+    FMSTR_TSA_STRUCT(struct cam_window_config_t)
+    FMSTR_TSA_MEMBER(struct cam_window_config_t, trans, FMSTR_TSA_UINT8)
+    FMSTR_TSA_MEMBER(struct cam_window_config_t, angle_start, FMSTR_TSA_UINT32)
+    FMSTR_TSA_MEMBER(struct cam_window_config_t, angle_width, FMSTR_TSA_UINT32)
     FMSTR_TSA_STRUCT(struct cam_states_t)
     FMSTR_TSA_MEMBER(struct cam_states_t, error, FMSTR_TSA_UINT8)
     FMSTR_TSA_MEMBER(struct cam_states_t, log_count, FMSTR_TSA_UINT8)
@@ -652,6 +732,14 @@ FMSTR_TSA_TABLE_BEGIN(fmstr_tsa_table_spark)
     FMSTR_TSA_MEMBER(struct spark_config_t, spark_count, FMSTR_TSA_UINT8)
     FMSTR_TSA_MEMBER(struct spark_config_t, p_single_spark_config, FMSTR_TSA_UINT32)
     FMSTR_TSA_MEMBER(struct spark_config_t, generation_disable, FMSTR_TSA_UINT8)
+    FMSTR_TSA_MEMBER(struct spark_config_t, recalc_count_max, FMSTR_TSA_UINT8)
+    FMSTR_TSA_MEMBER(struct spark_config_t, recalc_accel_ratio, FMSTR_TSA_UINT32)
+    FMSTR_TSA_MEMBER(struct spark_config_t, recalc_lead_time, FMSTR_TSA_UINT32)
+    FMSTR_TSA_MEMBER(struct spark_config_t, angle_offset_recalc_min, FMSTR_TSA_SINT32)
+    FMSTR_TSA_MEMBER(struct spark_config_t, cranking_tooth_angle, FMSTR_TSA_SINT32)
+    FMSTR_TSA_MEMBER(struct spark_config_t, cranking_delay, FMSTR_TSA_UINT32)
+    FMSTR_TSA_MEMBER(struct spark_config_t, cranking_tooth_period, FMSTR_TSA_UINT32)
+    FMSTR_TSA_MEMBER(struct spark_config_t, lateness_bucket_time, FMSTR_TSA_UINT32)
     FMSTR_TSA_STRUCT(struct single_spark_config_t)
     FMSTR_TSA_MEMBER(struct single_spark_config_t, end_angle, FMSTR_TSA_SINT32)
     FMSTR_TSA_MEMBER(struct single_spark_config_t, dwell_time, FMSTR_TSA_UINT32)
@@ -659,6 +747,7 @@ FMSTR_TSA_TABLE_BEGIN(fmstr_tsa_table_spark)
     FMSTR_TSA_STRUCT(struct spark_states_t)
     FMSTR_TSA_MEMBER(struct spark_states_t, error, FMSTR_TSA_UINT8)
     FMSTR_TSA_MEMBER(struct spark_states_t, dwell_time_applied, FMSTR_TSA_UINT32)
+    FMSTR_TSA_MEMBER(struct spark_states_t, lateness_hist, FMSTR_TSA_UINT32)
 FMSTR_TSA_TABLE_END()
 
 FMSTR_TSA_TABLE_BEGIN(fmstr_tsa_table_fuel)
@@ -687,10 +776,19 @@ FMSTR_TSA_TABLE_BEGIN(fmstr_tsa_table_fuel)
     FMSTR_TSA_MEMBER(struct fuel_config_t, injection_time_minimum, FMSTR_TSA_UINT32)
     FMSTR_TSA_MEMBER(struct fuel_config_t, off_time_minimum, FMSTR_TSA_UINT32)
     FMSTR_TSA_MEMBER(struct fuel_config_t, generation_disable, FMSTR_TSA_UINT8)
+    FMSTR_TSA_MEMBER(struct fuel_config_t, end_mode, FMSTR_TSA_UINT8)
+    FMSTR_TSA_MEMBER(struct fuel_config_t, angle_end_tolerance, FMSTR_TSA_SINT32)
+    FMSTR_TSA_MEMBER(struct fuel_config_t, end_time_deviation_max, FMSTR_TSA_UINT32)
+    FMSTR_TSA_MEMBER(struct fuel_config_t, recalc_count_max, FMSTR_TSA_UINT8)
+    FMSTR_TSA_MEMBER(struct fuel_config_t, recalc_accel_ratio, FMSTR_TSA_UINT32)
+    FMSTR_TSA_MEMBER(struct fuel_config_t, recalc_lead_time, FMSTR_TSA_UINT32)
+    FMSTR_TSA_MEMBER(struct fuel_config_t, angle_offset_recalc_min, FMSTR_TSA_SINT32)
+    FMSTR_TSA_MEMBER(struct fuel_config_t, lateness_bucket_time, FMSTR_TSA_UINT32)
     FMSTR_TSA_STRUCT(struct fuel_states_t)
     FMSTR_TSA_MEMBER(struct fuel_states_t, error, FMSTR_TSA_UINT8)
     FMSTR_TSA_MEMBER(struct fuel_states_t, injection_time_applied, FMSTR_TSA_UINT32)
     FMSTR_TSA_MEMBER(struct fuel_states_t, injection_start_angle, FMSTR_TSA_SINT32)
+    FMSTR_TSA_MEMBER(struct fuel_states_t, lateness_hist, FMSTR_TSA_UINT32)
 FMSTR_TSA_TABLE_END()
 
 FMSTR_TSA_TABLE_BEGIN(fmstr_tsa_table_inj)
@@ -725,6 +823,7 @@ FMSTR_TSA_TABLE_BEGIN(fmstr_tsa_table_inj)
     FMSTR_TSA_MEMBER(struct inj_config_t, angle_stop, FMSTR_TSA_SINT32)
     FMSTR_TSA_MEMBER(struct inj_config_t, injection_count, FMSTR_TSA_UINT8)
     FMSTR_TSA_MEMBER(struct inj_config_t, p_injection_config, FMSTR_TSA_UINT32)
+    FMSTR_TSA_MEMBER(struct inj_config_t, lateness_bucket_time, FMSTR_TSA_UINT32)
     FMSTR_TSA_STRUCT(struct inj_injection_config_t)
     FMSTR_TSA_MEMBER(struct inj_injection_config_t, angle_start, FMSTR_TSA_SINT32)
     FMSTR_TSA_MEMBER(struct inj_injection_config_t, phase_count, FMSTR_TSA_UINT8)
@@ -733,6 +832,7 @@ FMSTR_TSA_TABLE_BEGIN(fmstr_tsa_table_inj)
     FMSTR_TSA_MEMBER(struct inj_states_t, error, FMSTR_TSA_UINT8)
     FMSTR_TSA_MEMBER(struct inj_states_t, injection_idx, FMSTR_TSA_UINT8)
     FMSTR_TSA_MEMBER(struct inj_states_t, phase_idx, FMSTR_TSA_UINT8)
+    FMSTR_TSA_MEMBER(struct inj_states_t, lateness_hist, FMSTR_TSA_UINT32)
 FMSTR_TSA_TABLE_END()
 
 FMSTR_TSA_TABLE_BEGIN(fmstr_tsa_table_knock)
@@ -797,6 +897,8 @@ FMSTR_TSA_TABLE_END()
 *          -# On eTPU2, initialize the additional eTPU2 setting using
 *             fs_etpu2_init function
 *          -# Initialize channel setting using channel function APIs
+*          -# Reserve the coherent transfer CDC buffers using
+*             fs_etpu_coherent_init function
 *
 * @return  Zero or an error code is returned.
 *******************************************************************************/
@@ -918,6 +1020,10 @@ int32_t my_system_etpu_init()
     &tg_config);
   if(err_code != FS_ETPU_ERROR_NONE) return(err_code + (ETPU_TG_CRANK_CHAN<<16));
 
+  /* Reserve the CDC buffers of coherent transfers */
+  err_code = fs_etpu_coherent_init();
+  if(err_code != FS_ETPU_ERROR_NONE) return(err_code);
+
   return(FS_ETPU_ERROR_NONE);
 }
 
@@ -50,6 +50,13 @@
 /* Tooth Period [TCR1] and RPM */
 #define RPM2TP(x)                     (TCR1_FREQ_HZ/(x)*60/(TEETH_PER_CYCLE/2))
 #define TP2RPM(x)                     (TCR1_FREQ_HZ/(x)*60/(TEETH_PER_CYCLE/2))
+/* Normalized Tick Rate (eng_trr_norm) and RPM */
+#define RPM2TRR(x)                     (RPM2TP(x)*512/TCR2_TICKS_PER_TOOTH)
+
+/* eTPU engine A load [%] to start shedding non-critical functions */
+#define ETPU_LOAD_SHED_ON_PCT                                                85
+/* eTPU engine A load [%] to restore the shed functions - hysteresis */
+#define ETPU_LOAD_SHED_OFF_PCT                                               70
 
 /* Top-Dead Centers */
 #define TDC1_DEG       0    
@@ -42,9 +42,46 @@
 ******************************************************************************/
 /* eTPU Engine A load as a percentage */
 uint32_t etpu_engine_load;
+/* eTPU Engine A channels whose thread was aborted by the watchdog */
+uint32_t etpu_watchdog_chans;
+/* Non-critical eTPU functions are shed due to eTPU Engine A load */
+uint8_t etpu_load_shed;
+/* Count of engine phase errors detected by the CAM phase check */
+uint32_t cam_phase_errors;
+/* Restart the synchronization on a CAM phase error (0 = disabled) */
+uint8_t cam_phase_resync = 0;
+
+#if ISR_PROFILING
+/* ISR execution time profile [time base ticks] */
+struct isr_profile_t
+{
+  uint32_t min;
+  uint32_t max;
+  uint32_t avg;
+  uint32_t count;
+  uint32_t ring[ISR_PROFILE_RING_SIZE];  /* the last execution times */
+  uint32_t ring_idx;
+  uint32_t entry_time;
+  uint32_t sum;
+};
+struct isr_profile_t isr_profile[ISR_PROFILE_COUNT];
+
+/* ISR timeline trace event */
+struct isr_trace_event_t
+{
+  uint32_t time;     /* time base */
+  uint8_t  profile;  /* ISR_PROFILE_x */
+  uint8_t  phase;    /* ISR_TRACE_BEGIN or ISR_TRACE_END */
+};
+/* ISR timeline trace ring and the index of the next event to write */
+struct isr_trace_event_t isr_trace[ISR_TRACE_SIZE];
+uint32_t isr_trace_idx;
+#endif
 
 /* eTPU log arrays */
 uint24_t etpu_cam_log[CAM_LOG_SIZE];
+/* position of the last incremental read of the CAM log */
+struct cam_log_read_t etpu_cam_log_read;
 uint24_t etpu_tooth_period_log[TEETH_PER_CYCLE];
 
 #define TCR22DEG(x) (x * 720.0 / TCR2_TICKS_PER_CYCLE)
@@ -52,6 +89,32 @@ uint24_t etpu_tooth_period_log[TEETH_PER_CYCLE];
 double engine_position;
 /* current (sampled repeatably) engine speed in rpm */
 double engine_speed;
+/* built-in test profile step */
+int test_step = 0;
+
+/* Background task scheduler time base [ticks per ms] - the CPU time base
+   on the target, the simulation time in us on the simulator */
+#ifndef CPU32SIM
+#define SCHED_TICKS_PER_MS ((uint32_t)(SYS_FREQ_HZ/1E3))
+#else
+#define SCHED_TICKS_PER_MS 1000
+#endif
+/* Background task scheduler task */
+struct sched_task_t
+{
+  void (*p_func)(void);  /* task function */
+  uint32_t period;       /* release period [ticks], 0 = per engine cycle */
+  uint32_t release;      /* next release time [ticks] */
+  uint32_t exec_time;    /* last execution time [ticks] */
+  uint32_t exec_max;     /* maximum execution time [ticks] */
+  uint32_t count;        /* count of executions */
+  uint32_t overruns;     /* count of missed releases */
+};
+struct sched_task_t sched_task[SCHED_TASK_COUNT];
+/* count of engine cycles signalled by the CRANK ISR and served by the
+   per-cycle task */
+volatile uint32_t sched_cycle_count;
+uint32_t sched_cycle_served;
 
 #ifdef CPU32SIM
 enum ETPU_ISR_TYPE
@@ -70,6 +133,69 @@ volatile struct eTPU_struct * const eTPU;
 uint32_t *fs_etpu_free_param;
 int g_complete_flag = 0;
 int g_testbed_flag = 0;
+/* Co-simulation input - engine speed in rpm written by the simulation
+   script or a plant model stepping it, 0 = use the built-in test profile */
+uint32_t cosim_engine_speed_rpm = 0;
+
+/* Closed-loop engine plant model - mean-value plus cylinder torque */
+#define PLANT_RPM_PER_INJ_USEC        0.02  /* speed gain per injection time */
+#define PLANT_LOAD_RPM_PER_SEC        2000  /* speed loss due to the load */
+#define PLANT_FRICTION_PER_SEC        2.3   /* speed loss due to friction */
+#define PLANT_SPEED_MIN_RPM            100
+#define PLANT_SPEED_MAX_RPM           8000
+/* plant model enable - written by the simulation script */
+uint32_t plant_enable = 0;
+/* plant model engine speed in rpm */
+double plant_speed_rpm = 2000;
+
+/* Fault injection */
+#define FAULT_NONE                       0
+#define FAULT_CRANK_DROPOUT              1  /* no crank/cam signal */
+#define FAULT_ISR_DELAY                  2  /* delayed CRANK ISR service */
+#define FAULT_TOOTH_NOISE                4  /* random tooth period noise */
+#define FAULT_EXTRA_TEETH                8  /* a tooth in the middle of each
+                                               tooth period */
+#define FAULT_DATA_RAM                  16  /* corrupted CRANK tooth counter */
+#define FAULT_CLASS_COUNT                5
+#define FAULT_NOISE_PCT                 10  /* tooth period noise range [%] */
+#define FAULT_RANDOM_PERIOD_MIN_US  100000  /* random fault period range */
+#define FAULT_RANDOM_PERIOD_MAX_US 1000000
+/* fault request - written by the simulation script, cleared when applied */
+uint32_t fault_request = FAULT_NONE;
+/* fault duration in us - written by the simulation script */
+uint32_t fault_duration_us = 20000;
+/* CRANK ISR service delay in us - written by the simulation script */
+uint32_t fault_isr_delay_us = 100;
+/* random fault injection seed - 0 = no random faults */
+uint32_t fault_seed = 0;
+/* fault currently applied */
+uint32_t fault_active = FAULT_NONE;
+/* time from the last fault start to FULL_SYNC recovery in us, and maximum */
+uint32_t fault_recovery_time_us;
+uint32_t fault_recovery_time_max_us;
+/* worst-case CRANK tooth service latency in us since the start, including
+   the stall and sync link bursts */
+uint32_t tooth_latency_max_us;
+
+/* Capacity curve - eTPU load and output lateness vs. rpm */
+#define CAPACITY_RPM_START            1000
+#define CAPACITY_RPM_STEP              500
+#define CAPACITY_STEP_COUNT             16
+#define CAPACITY_STEP_TIME_US       200000
+#define CAPACITY_LOAD_LIMIT_PCT         95
+/* capacity sweep enable - written by the simulation script */
+uint32_t capacity_sweep_enable = 0;
+/* engine speed [rpm], maximum eTPU engine A load [%] and count of SPARK and
+   FUEL output edges in the worst lateness bucket, per sweep step */
+uint32_t capacity_rpm[CAPACITY_STEP_COUNT];
+uint32_t capacity_load[CAPACITY_STEP_COUNT];
+uint32_t capacity_late_edges[CAPACITY_STEP_COUNT];
+/* the lowest rpm with late edges or load over the limit, 0 = none found */
+uint32_t capacity_break_rpm;
+/* the sweep is done */
+uint32_t capacity_sweep_done;
+/* engine speed set-point [rpm] of the running sweep step, 0 = not running */
+uint32_t capacity_speed_rpm;
 #endif
 
 #ifndef CPU32SIM
@@ -89,10 +215,46 @@ int g_testbed_flag = 0;
 
 FMSTR_TSA_TABLE_BEGIN(fmstr_tsa_table_etpu_load)
     FMSTR_TSA_RO_VAR(etpu_engine_load, FMSTR_TSA_UINT32)
+    FMSTR_TSA_RO_VAR(etpu_watchdog_chans, FMSTR_TSA_UINT32)
+    FMSTR_TSA_RO_VAR(etpu_load_shed, FMSTR_TSA_UINT8)
+FMSTR_TSA_TABLE_END()
+
+#if ISR_PROFILING
+FMSTR_TSA_TABLE_BEGIN(fmstr_tsa_table_isr_profile)
+    FMSTR_TSA_RO_VAR(isr_profile, FMSTR_TSA_USERTYPE(struct isr_profile_t))
+
+    FMSTR_TSA_STRUCT(struct isr_profile_t)
+    FMSTR_TSA_MEMBER(struct isr_profile_t, min, FMSTR_TSA_UINT32)
+    FMSTR_TSA_MEMBER(struct isr_profile_t, max, FMSTR_TSA_UINT32)
+    FMSTR_TSA_MEMBER(struct isr_profile_t, avg, FMSTR_TSA_UINT32)
+    FMSTR_TSA_MEMBER(struct isr_profile_t, count, FMSTR_TSA_UINT32)
+    FMSTR_TSA_MEMBER(struct isr_profile_t, ring, FMSTR_TSA_UINT32)
+
+    FMSTR_TSA_RO_VAR(isr_trace, FMSTR_TSA_USERTYPE(struct isr_trace_event_t))
+    FMSTR_TSA_RO_VAR(isr_trace_idx, FMSTR_TSA_UINT32)
+
+    FMSTR_TSA_STRUCT(struct isr_trace_event_t)
+    FMSTR_TSA_MEMBER(struct isr_trace_event_t, time, FMSTR_TSA_UINT32)
+    FMSTR_TSA_MEMBER(struct isr_trace_event_t, profile, FMSTR_TSA_UINT8)
+    FMSTR_TSA_MEMBER(struct isr_trace_event_t, phase, FMSTR_TSA_UINT8)
+FMSTR_TSA_TABLE_END()
+#endif
+
+FMSTR_TSA_TABLE_BEGIN(fmstr_tsa_table_sched)
+    FMSTR_TSA_RO_VAR(sched_task, FMSTR_TSA_USERTYPE(struct sched_task_t))
+
+    FMSTR_TSA_STRUCT(struct sched_task_t)
+    FMSTR_TSA_MEMBER(struct sched_task_t, period, FMSTR_TSA_UINT32)
+    FMSTR_TSA_MEMBER(struct sched_task_t, exec_time, FMSTR_TSA_UINT32)
+    FMSTR_TSA_MEMBER(struct sched_task_t, exec_max, FMSTR_TSA_UINT32)
+    FMSTR_TSA_MEMBER(struct sched_task_t, count, FMSTR_TSA_UINT32)
+    FMSTR_TSA_MEMBER(struct sched_task_t, overruns, FMSTR_TSA_UINT32)
 FMSTR_TSA_TABLE_END()
 
 FMSTR_TSA_TABLE_BEGIN(fmstr_tsa_table_etpu_logs)
     FMSTR_TSA_RO_VAR(etpu_cam_log, FMSTR_TSA_UINT32)
+    FMSTR_TSA_RO_VAR(cam_phase_errors, FMSTR_TSA_UINT32)
+    FMSTR_TSA_RW_VAR(cam_phase_resync, FMSTR_TSA_UINT8)
     FMSTR_TSA_RO_VAR(etpu_tooth_period_log, FMSTR_TSA_UINT32)
 FMSTR_TSA_TABLE_END()
 
@@ -102,6 +264,10 @@ FMSTR_TSA_TABLE_END()
  */
 FMSTR_TSA_TABLE_LIST_BEGIN()
     FMSTR_TSA_TABLE(fmstr_tsa_table_etpu_load)
+#if ISR_PROFILING
+    FMSTR_TSA_TABLE(fmstr_tsa_table_isr_profile)
+#endif
+    FMSTR_TSA_TABLE(fmstr_tsa_table_sched)
     FMSTR_TSA_TABLE(fmstr_tsa_table_etpu_logs)
     FMSTR_TSA_TABLE(fmstr_tsa_table_etpu_scaling)
     FMSTR_TSA_TABLE(fmstr_tsa_table_crank)
@@ -120,8 +286,31 @@ FMSTR_TSA_TABLE_LIST_END()
 void gpio_init(void);
 void fmpll_init(void);
 void esci_a_init(void);
+void time_base_init(void);
 void intc_init(void);
 uint32_t get_etpu_load_a(void);
+uint32_t get_etpu_watchdog_a(void);
+#if ISR_PROFILING
+void isr_profile_init(void);
+void isr_profile_entry(uint32_t profile);
+void isr_profile_exit(uint32_t profile);
+#endif
+void etpu_load_shedding(uint32_t load);
+void cam_phase_check(void);
+void sched_init(void);
+void sched_run(void);
+void sched_task_1ms(void);
+void sched_task_10ms(void);
+void sched_task_cycle(void);
+void engine_speed_setpoint(double time);
+#ifdef CPU32SIM
+void plant_cylinder_event(uint24_t injection_time, uint24_t dwell_time);
+void fault_injection(double time);
+struct tg_config_t *fault_tg_config(void);
+void fault_recovery_check(uint8_t eng_pos_state);
+void tooth_latency_check(uint24_t tooth_latency);
+void capacity_sweep(double time);
+#endif
 
 /******************************************************************************
 * Interrupt handlers
@@ -169,17 +358,30 @@ void aw_to_nxp_isr_translator(int32_t fint, uint32_t chan_mask)
 void etpu_crank_isr(void)
 {
   uint24_t tcr2_adjustment;
+#ifdef CPU32SIM
+  double delay_end_time;
+#endif
 
 #ifndef CPU32SIM
-  fs_gpio_write_data(TEST_PAD_CRANK, 1);
+  ISR_ENTRY(ISR_PROFILE_CRANK, TEST_PAD_CRANK);
 #else
   etpu_isr_active = EIT_CRANK;
+  if(fault_active & FAULT_ISR_DELAY)
+  {
+    /* Delay the ISR service */
+    delay_end_time = read_time() + fault_isr_delay_us;
+    while(read_time() < delay_end_time);
+  }
 #endif
 
   fs_etpu_clear_chan_interrupt_flag(ETPU_CRANK_CHAN);
  
   /* Follow Engine Position state */
   fs_etpu_crank_get_states(&crank_instance, &crank_states);
+#ifdef CPU32SIM
+  fault_recovery_check(crank_states.eng_pos_state);
+  tooth_latency_check(crank_states.tooth_latency_max);
+#endif
   switch(crank_states.eng_pos_state)
   {
   case FS_ETPU_ENG_POS_SEEK:
@@ -197,7 +399,7 @@ void etpu_crank_isr(void)
        1) SET tcr2_adjustment
        2) ASSIGN CRANK HSR = CRANK_HSR_SET_SYNC. */
     fs_etpu_cam_get_states(&cam_instance, &cam_states);
-    fs_etpu_cam_copy_log(&cam_instance, &etpu_cam_log[0]);
+    fs_etpu_cam_copy_log_new(&cam_instance, &etpu_cam_log_read, &etpu_cam_log[0]);
     
     if((cam_states.log_idx == 3) && (etpu_cam_log[0] & 0x01000000))
     {
@@ -224,6 +426,8 @@ void etpu_crank_isr(void)
     break;
   case FS_ETPU_ENG_POS_FULL_SYNC:
     /* Regular interrupt on the first tooth every engine cycle. */
+    /* Release the per-cycle background task */
+    sched_cycle_count++;
     /* Clear errors */
     crank_states.error = 0;
     cam_states.error = 0;
@@ -232,18 +436,22 @@ void etpu_crank_isr(void)
 
   /* Interface CRANK eTPU function */
   fs_etpu_crank_get_states(&crank_instance, &crank_states);
+#ifdef CPU32SIM
+  tooth_latency_check(crank_states.tooth_latency_max);
+#endif
   fs_etpu_crank_config(&crank_instance, &crank_config);
-  fs_etpu_crank_copy_tooth_period_log(&crank_instance, &etpu_tooth_period_log[0]);
-  /* Interface CAM eTPU function */
-  fs_etpu_cam_get_states(&cam_instance, &cam_states);
+  /* Interface CAM eTPU function - the CAM states (errors) are read
+     in etpu_cam_isr */
   fs_etpu_cam_config(&cam_instance, &cam_config);
-  fs_etpu_cam_copy_log(&cam_instance, &etpu_cam_log[0]);
+  fs_etpu_cam_copy_log_new(&cam_instance, &etpu_cam_log_read, &etpu_cam_log[0]);
 
     /* Evaluate eTPU load */
   etpu_engine_load = get_etpu_load_a();
+  etpu_watchdog_chans |= get_etpu_watchdog_a();
+  etpu_load_shedding(etpu_engine_load);
 
 #ifndef CPU32SIM
-  fs_gpio_write_data(TEST_PAD_CRANK, 0);
+  ISR_EXIT(ISR_PROFILE_CRANK, TEST_PAD_CRANK);
 #else
   etpu_isr_active = EIT_INACTIVE;
 #endif
@@ -262,7 +470,7 @@ void etpu_crank_isr(void)
 void etpu_cam_isr(void)
 {
 #ifndef CPU32SIM
-  fs_gpio_write_data(TEST_PAD_CAM, 1);
+  ISR_ENTRY(ISR_PROFILE_CAM, TEST_PAD_CAM);
 #else
   etpu_isr_active = EIT_CAM;
 #endif
@@ -271,10 +479,11 @@ void etpu_cam_isr(void)
 
   /* Interface CAM eTPU function */
   fs_etpu_cam_get_states(&cam_instance, &cam_states);
+  cam_phase_check();
   fs_etpu_cam_config(&cam_instance, &cam_config);
   
 #ifndef CPU32SIM
-  fs_gpio_write_data(TEST_PAD_CAM, 0);
+  ISR_EXIT(ISR_PROFILE_CAM, TEST_PAD_CAM);
 #else
   etpu_isr_active = EIT_INACTIVE;
 #endif
@@ -294,7 +503,7 @@ void etpu_cam_isr(void)
 void etpu_fuel_1_isr(void)
 {
 #ifndef CPU32SIM
-  fs_gpio_write_data(TEST_PAD_FUEL, 1);
+  ISR_ENTRY(ISR_PROFILE_FUEL, TEST_PAD_FUEL);
 #else
   etpu_isr_active = EIT_FUEL;
 #endif
@@ -307,7 +516,7 @@ void etpu_fuel_1_isr(void)
   fs_etpu_fuel_config(&fuel_1_instance, &fuel_config);
   
 #ifndef CPU32SIM
-  fs_gpio_write_data(TEST_PAD_FUEL, 0);
+  ISR_EXIT(ISR_PROFILE_FUEL, TEST_PAD_FUEL);
 #else
   etpu_isr_active = EIT_INACTIVE;
 #endif
@@ -327,7 +536,7 @@ void etpu_fuel_1_isr(void)
 void etpu_fuel_2_isr(void)
 {
 #ifndef CPU32SIM
-  fs_gpio_write_data(TEST_PAD_FUEL, 1);
+  ISR_ENTRY(ISR_PROFILE_FUEL, TEST_PAD_FUEL);
 #else
   etpu_isr_active = EIT_FUEL;
 #endif
@@ -340,7 +549,7 @@ void etpu_fuel_2_isr(void)
   fs_etpu_fuel_config(&fuel_2_instance, &fuel_config);
   
 #ifndef CPU32SIM
-  fs_gpio_write_data(TEST_PAD_FUEL, 0);
+  ISR_EXIT(ISR_PROFILE_FUEL, TEST_PAD_FUEL);
 #else
   etpu_isr_active = EIT_INACTIVE;
 #endif
@@ -360,7 +569,7 @@ void etpu_fuel_2_isr(void)
 void etpu_fuel_3_isr(void)
 {
 #ifndef CPU32SIM
-  fs_gpio_write_data(TEST_PAD_FUEL, 1);
+  ISR_ENTRY(ISR_PROFILE_FUEL, TEST_PAD_FUEL);
 #else
   etpu_isr_active = EIT_FUEL;
 #endif
@@ -373,7 +582,7 @@ void etpu_fuel_3_isr(void)
   fs_etpu_fuel_config(&fuel_3_instance, &fuel_config);
   
 #ifndef CPU32SIM
-  fs_gpio_write_data(TEST_PAD_FUEL, 0);
+  ISR_EXIT(ISR_PROFILE_FUEL, TEST_PAD_FUEL);
 #else
   etpu_isr_active = EIT_INACTIVE;
 #endif
@@ -393,7 +602,7 @@ void etpu_fuel_3_isr(void)
 void etpu_fuel_4_isr(void)
 {
 #ifndef CPU32SIM
-  fs_gpio_write_data(TEST_PAD_FUEL, 1);
+  ISR_ENTRY(ISR_PROFILE_FUEL, TEST_PAD_FUEL);
 #else
   etpu_isr_active = EIT_FUEL;
 #endif
@@ -406,7 +615,7 @@ void etpu_fuel_4_isr(void)
   fs_etpu_fuel_config(&fuel_4_instance, &fuel_config);
   
 #ifndef CPU32SIM
-  fs_gpio_write_data(TEST_PAD_FUEL, 0);
+  ISR_EXIT(ISR_PROFILE_FUEL, TEST_PAD_FUEL);
 #else
   etpu_isr_active = EIT_INACTIVE;
 #endif
@@ -426,7 +635,7 @@ void etpu_fuel_4_isr(void)
 void etpu_spark_1_isr(void)
 {
 #ifndef CPU32SIM
-  fs_gpio_write_data(TEST_PAD_SPARK, 1);
+  ISR_ENTRY(ISR_PROFILE_SPARK, TEST_PAD_SPARK);
 #else
   etpu_isr_active = EIT_SPARK;
 #endif
@@ -437,9 +646,15 @@ void etpu_spark_1_isr(void)
   /* Interface SPARK eTPU function */
   fs_etpu_spark_get_states(&spark_1_instance, &spark_1_states);
   fs_etpu_spark_config(&spark_1_instance, &spark_config);
+
+#ifdef CPU32SIM
+  /* Closed-loop plant model - cylinder 1 combustion */
+  plant_cylinder_event(fuel_1_states.injection_time_applied,
+                       spark_1_states.dwell_time_applied);
+#endif
   
 #ifndef CPU32SIM
-  fs_gpio_write_data(TEST_PAD_SPARK, 0);
+  ISR_EXIT(ISR_PROFILE_SPARK, TEST_PAD_SPARK);
 #else
   etpu_isr_active = EIT_INACTIVE;
 #endif
@@ -459,7 +674,7 @@ void etpu_spark_1_isr(void)
 void etpu_spark_2_isr(void)
 {
 #ifndef CPU32SIM
-  fs_gpio_write_data(TEST_PAD_SPARK, 1);
+  ISR_ENTRY(ISR_PROFILE_SPARK, TEST_PAD_SPARK);
 #else
   etpu_isr_active = EIT_SPARK;
 #endif
@@ -470,9 +685,15 @@ void etpu_spark_2_isr(void)
   /* Interface SPARK eTPU function */
   fs_etpu_spark_get_states(&spark_2_instance, &spark_2_states);
   fs_etpu_spark_config(&spark_2_instance, &spark_config);
+
+#ifdef CPU32SIM
+  /* Closed-loop plant model - cylinder 2 combustion */
+  plant_cylinder_event(fuel_2_states.injection_time_applied,
+                       spark_2_states.dwell_time_applied);
+#endif
   
 #ifndef CPU32SIM
-  fs_gpio_write_data(TEST_PAD_SPARK, 0);
+  ISR_EXIT(ISR_PROFILE_SPARK, TEST_PAD_SPARK);
 #else
   etpu_isr_active = EIT_INACTIVE;
 #endif
@@ -492,7 +713,7 @@ void etpu_spark_2_isr(void)
 void etpu_spark_3_isr(void)
 {
 #ifndef CPU32SIM
-  fs_gpio_write_data(TEST_PAD_SPARK, 1);
+  ISR_ENTRY(ISR_PROFILE_SPARK, TEST_PAD_SPARK);
 #else
   etpu_isr_active = EIT_SPARK;
 #endif
@@ -503,9 +724,15 @@ void etpu_spark_3_isr(void)
   /* Interface SPARK eTPU function */
   fs_etpu_spark_get_states(&spark_3_instance, &spark_3_states);
   fs_etpu_spark_config(&spark_3_instance, &spark_config);
+
+#ifdef CPU32SIM
+  /* Closed-loop plant model - cylinder 3 combustion */
+  plant_cylinder_event(fuel_3_states.injection_time_applied,
+                       spark_3_states.dwell_time_applied);
+#endif
   
 #ifndef CPU32SIM
-  fs_gpio_write_data(TEST_PAD_SPARK, 0);
+  ISR_EXIT(ISR_PROFILE_SPARK, TEST_PAD_SPARK);
 #else
   etpu_isr_active = EIT_INACTIVE;
 #endif
@@ -525,7 +752,7 @@ void etpu_spark_3_isr(void)
 void etpu_spark_4_isr(void)
 {
 #ifndef CPU32SIM
-  fs_gpio_write_data(TEST_PAD_SPARK, 1);
+  ISR_ENTRY(ISR_PROFILE_SPARK, TEST_PAD_SPARK);
 #else
   etpu_isr_active = EIT_SPARK;
 #endif
@@ -536,9 +763,15 @@ void etpu_spark_4_isr(void)
   /* Interface SPARK eTPU function */
   fs_etpu_spark_get_states(&spark_4_instance, &spark_4_states);
   fs_etpu_spark_config(&spark_4_instance, &spark_config);
+
+#ifdef CPU32SIM
+  /* Closed-loop plant model - cylinder 4 combustion */
+  plant_cylinder_event(fuel_4_states.injection_time_applied,
+                       spark_4_states.dwell_time_applied);
+#endif
   
 #ifndef CPU32SIM
-  fs_gpio_write_data(TEST_PAD_SPARK, 0);
+  ISR_EXIT(ISR_PROFILE_SPARK, TEST_PAD_SPARK);
 #else
   etpu_isr_active = EIT_INACTIVE;
 #endif
@@ -558,7 +791,7 @@ void etpu_spark_4_isr(void)
 void etpu_knock_1_isr(void)
 {
 #ifndef CPU32SIM
-  fs_gpio_write_data(TEST_PAD_KNOCK, 1);
+  ISR_ENTRY(ISR_PROFILE_KNOCK, TEST_PAD_KNOCK);
 #else
   etpu_isr_active = EIT_KNOCK;
 #endif
@@ -569,7 +802,7 @@ void etpu_knock_1_isr(void)
   fs_etpu_knock_config(&knock_1_instance, &knock_1_config);
   
 #ifndef CPU32SIM
-  fs_gpio_write_data(TEST_PAD_KNOCK, 0);
+  ISR_EXIT(ISR_PROFILE_KNOCK, TEST_PAD_KNOCK);
 #else
   etpu_isr_active = EIT_INACTIVE;
 #endif
@@ -589,7 +822,7 @@ void etpu_knock_1_isr(void)
 void etpu_knock_2_isr(void)
 {
 #ifndef CPU32SIM
-  fs_gpio_write_data(TEST_PAD_KNOCK, 1);
+  ISR_ENTRY(ISR_PROFILE_KNOCK, TEST_PAD_KNOCK);
 #else
   etpu_isr_active = EIT_KNOCK;
 #endif
@@ -600,7 +833,7 @@ void etpu_knock_2_isr(void)
   fs_etpu_knock_config(&knock_2_instance, &knock_2_config);
   
 #ifndef CPU32SIM
-  fs_gpio_write_data(TEST_PAD_KNOCK, 0);
+  ISR_EXIT(ISR_PROFILE_KNOCK, TEST_PAD_KNOCK);
 #else
   etpu_isr_active = EIT_INACTIVE;
 #endif
@@ -620,7 +853,7 @@ void etpu_knock_2_isr(void)
 void etpu_inj_1_isr(void)
 {
 #ifndef CPU32SIM
-  fs_gpio_write_data(TEST_PAD_INJ, 1);
+  ISR_ENTRY(ISR_PROFILE_INJ, TEST_PAD_INJ);
 #else
   etpu_isr_active = EIT_INJ;
 #endif
@@ -633,7 +866,7 @@ void etpu_inj_1_isr(void)
   fs_etpu_inj_config(&inj_1_instance, &inj_config);
   
 #ifndef CPU32SIM
-  fs_gpio_write_data(TEST_PAD_INJ, 0);
+  ISR_EXIT(ISR_PROFILE_INJ, TEST_PAD_INJ);
 #else
   etpu_isr_active = EIT_INACTIVE;
 #endif
@@ -653,7 +886,7 @@ void etpu_inj_1_isr(void)
 void etpu_inj_2_isr(void)
 {
 #ifndef CPU32SIM
-  fs_gpio_write_data(TEST_PAD_INJ, 1);
+  ISR_ENTRY(ISR_PROFILE_INJ, TEST_PAD_INJ);
 #else
   etpu_isr_active = EIT_INJ;
 #endif
@@ -666,7 +899,7 @@ void etpu_inj_2_isr(void)
   fs_etpu_inj_config(&inj_2_instance, &inj_config);
   
 #ifndef CPU32SIM
-  fs_gpio_write_data(TEST_PAD_INJ, 0);
+  ISR_EXIT(ISR_PROFILE_INJ, TEST_PAD_INJ);
 #else
   etpu_isr_active = EIT_INACTIVE;
 #endif
@@ -686,7 +919,7 @@ void etpu_inj_2_isr(void)
 void etpu_inj_3_isr(void)
 {
 #ifndef CPU32SIM
-  fs_gpio_write_data(TEST_PAD_INJ, 1);
+  ISR_ENTRY(ISR_PROFILE_INJ, TEST_PAD_INJ);
 #else
   etpu_isr_active = EIT_INJ;
 #endif
@@ -699,7 +932,7 @@ void etpu_inj_3_isr(void)
   fs_etpu_inj_config(&inj_3_instance, &inj_config);
   
 #ifndef CPU32SIM
-  fs_gpio_write_data(TEST_PAD_INJ, 0);
+  ISR_EXIT(ISR_PROFILE_INJ, TEST_PAD_INJ);
 #else
   etpu_isr_active = EIT_INACTIVE;
 #endif
@@ -719,7 +952,7 @@ void etpu_inj_3_isr(void)
 void etpu_inj_4_isr(void)
 {
 #ifndef CPU32SIM
-  fs_gpio_write_data(TEST_PAD_INJ, 1);
+  ISR_ENTRY(ISR_PROFILE_INJ, TEST_PAD_INJ);
 #else
   etpu_isr_active = EIT_INJ;
 #endif
@@ -732,7 +965,7 @@ void etpu_inj_4_isr(void)
   fs_etpu_inj_config(&inj_4_instance, &inj_config);
   
 #ifndef CPU32SIM
-  fs_gpio_write_data(TEST_PAD_INJ, 0);
+  ISR_EXIT(ISR_PROFILE_INJ, TEST_PAD_INJ);
 #else
   etpu_isr_active = EIT_INACTIVE;
 #endif
@@ -752,7 +985,7 @@ void etpu_inj_4_isr(void)
 void etpu_tg_isr(void)
 {
 #ifndef CPU32SIM
-  fs_gpio_write_data(TEST_PAD_TG, 1);
+  ISR_ENTRY(ISR_PROFILE_TG, TEST_PAD_TG);
 #else
   etpu_isr_active = EIT_TG;
 #endif
@@ -761,10 +994,14 @@ void etpu_tg_isr(void)
 
   /* Interface TG eTPU function */
   fs_etpu_tg_get_states(&tg_instance, &tg_states);
+#ifdef CPU32SIM
+  fs_etpu_tg_config(&tg_instance, fault_tg_config());
+#else
   fs_etpu_tg_config(&tg_instance, &tg_config);
+#endif
   
 #ifndef CPU32SIM
-  fs_gpio_write_data(TEST_PAD_TG, 0);
+  ISR_EXIT(ISR_PROFILE_TG, TEST_PAD_TG);
 #else
   etpu_isr_active = EIT_INACTIVE;
 #endif
@@ -778,19 +1015,23 @@ void etpu_tg_isr(void)
 * @return  N/A
 *
 * @note    The main routine includes only initialization and start of 
-*          individual modules and a background loop. 
+*          individual modules and a background loop. The background loop
+*          runs the scheduled tasks and FreeMASTER.
 *
 ******************************************************************************/
 int user_main(void) 
 {
   double current_time;
-  int test_step = 0;
   
 #ifndef CPU32SIM
   /* Initialize GPIO, FMPLL, eSCI A */
   gpio_init();
   fmpll_init();
   esci_a_init();
+  time_base_init();
+#if ISR_PROFILING
+  isr_profile_init();
+#endif
 #endif
   
   /* Initialize eTPU */
@@ -820,39 +1061,15 @@ int user_main(void)
   fs_etpu_tg_config(&tg_instance, &tg_config);
 #endif
   
+  /* Start the background task scheduler */
+  sched_init();
+
   /* Loop forever */
   for (;;)
   {
-    /* Set Fuel injection time - the value is updated in by FreeMASTER */
-    fs_etpu_fuel_update_injection_time(&fuel_1_instance, &fuel_config);
-
-    /* Interface TG eTPU function - this sets engine speed updated by FreeMASTER */
-    fs_etpu_tg_get_states(&tg_instance, &tg_states);
-    fs_etpu_tg_config(&tg_instance, &tg_config);
-  
-    /* update Crank and Cam latest states to see them in FreeMaster*/
-    fs_etpu_crank_get_states(&crank_instance, &crank_states);
-    fs_etpu_cam_get_states(&cam_instance, &cam_states);
+    /* Run the background tasks which are due */
+    sched_run();
 
-    /* refresh current engine position */
-    engine_position = TCR22DEG(fs_etpu_crank_get_angle_reseting());
-    /* refresh current engine speed */
-    engine_speed = TP2RPM(crank_states.last_tooth_period_norm);
-
-    current_time = read_time();
-    if (test_step == 0 && current_time > 60000.0)
-    {
-        //fuel_config.injection_time = USEC2TCR1(30000);
-        tg_config.tooth_period_target = RPM2TP(2000);
-        test_step = 1;
-    }
-    if (test_step == 1 && current_time > 66000.0)
-    {
-        //fuel_config.injection_time = USEC2TCR1(30000);
-        tg_config.tooth_period_target = RPM2TP(5000);
-        test_step = 2;
-    }
-    
 #ifndef CPU32SIM
     /* FreeMASTER processing on background */
     FMSTR_Poll();
@@ -1047,6 +1264,24 @@ void esci_a_init(void)
   ESCI_A.CR1.B.PE = 0;               // parity control disable
   ESCI_A.CR1.B.SBR = 53;             // Baud rate = 115200 @ 100MHz
 }
+
+/***************************************************************************//*!
+*
+* @brief   Enable the CPU time base, used by the background task scheduler
+*          and the ISR profiling.
+*
+* @return  N/A
+*
+******************************************************************************/
+void time_base_init(void)
+{
+  uint32_t hid0;
+
+  /* Enable the time base - HID0[TBEN] */
+  asm volatile("mfspr %0, 1008" : "=r" (hid0));
+  hid0 |= 0x00004000;
+  asm volatile("mtspr 1008, %0" : : "r" (hid0));
+}
 #endif
 
 /***************************************************************************//*!
@@ -1078,6 +1313,779 @@ uint32_t get_etpu_load_a(void)
   return(100*(time_cnt - idle_cnt)/time_cnt);
 }
 
+/***************************************************************************//*!
+*
+* @brief   Check the eTPU engine A watchdog.
+*
+* @note    The watchdog is configured in etpu_gct.c to abort threads longer
+*          than the count in wdtr_a. The demo keeps the watchdog disabled,
+*          because an aborted thread disables its channel and nothing
+*          recovers it; the count must be derived from the measured
+*          worst-case thread lengths before the watchdog is enabled.
+*          Only the engine A watchdog status flags are cleared after reading.
+*          The global exception flags in MCR are left untouched, because
+*          MCR.GEC would clear the other pending global exceptions too.
+*
+* @warning This function is applicable on eTPU2 only.
+*
+* @return  A mask of engine A channels whose thread was aborted by
+*          the watchdog since the last call (bit n = channel n).
+*
+******************************************************************************/
+uint32_t get_etpu_watchdog_a(void)
+{
+  uint32_t chans;
+
+  chans = fs_etpu_get_watchdog_status_a();
+  if(chans != 0)
+  {
+    fs_etpu_clear_watchdog_status_a(chans);
+  }
+  return(chans);
+}
+
+/***************************************************************************//*!
+*
+* @brief   Shed or restore non-critical eTPU functions based on the load.
+*
+* @note    When the eTPU engine A load reaches ETPU_LOAD_SHED_ON_PCT,
+*          the functions which do not affect the SPARK and FUEL output edge
+*          timing are demoted:
+*          - the KNOCK channels are switched from trigger mode to gate mode,
+*            so no trigger pulses are generated within the windows,
+*          - the extra start angle recalculations of SPARK and FUEL
+*            are disabled.
+*          The original settings are restored when the load drops below
+*          ETPU_LOAD_SHED_OFF_PCT.
+*          Only the configuration structures are updated here. The changes
+*          are applied by the channel interrupt handlers, which write
+*          the configuration at a safe moment (KNOCK window end, SPARK and
+*          FUEL end of output).
+*
+* @param   load - eTPU engine A load as a percentage.
+*
+* @return  N/A
+*
+******************************************************************************/
+void etpu_load_shedding(uint32_t load)
+{
+  static uint8_t knock_1_mode;
+  static uint8_t knock_2_mode;
+  static uint8_t spark_recalc_count_max;
+  static uint8_t fuel_recalc_count_max;
+
+  if((etpu_load_shed == 0) && (load >= ETPU_LOAD_SHED_ON_PCT))
+  {
+    knock_1_mode = knock_1_config.mode;
+    knock_2_mode = knock_2_config.mode;
+    spark_recalc_count_max = spark_config.recalc_count_max;
+    fuel_recalc_count_max = fuel_config.recalc_count_max;
+
+    knock_1_config.mode = FS_ETPU_KNOCK_FM1_MODE_GATE;
+    knock_2_config.mode = FS_ETPU_KNOCK_FM1_MODE_GATE;
+    spark_config.recalc_count_max = 0;
+    fuel_config.recalc_count_max = 0;
+    etpu_load_shed = 1;
+  }
+  else if((etpu_load_shed != 0) && (load < ETPU_LOAD_SHED_OFF_PCT))
+  {
+    knock_1_config.mode = knock_1_mode;
+    knock_2_config.mode = knock_2_mode;
+    spark_config.recalc_count_max = spark_recalc_count_max;
+    fuel_config.recalc_count_max = fuel_recalc_count_max;
+    etpu_load_shed = 0;
+  }
+}
+
+/***************************************************************************//*!
+*
+* @brief   Handle the result of the CAM phase check.
+*
+* @note    In full sync, the eTPU CAM function checks the Cam log of each
+*          engine cycle against the expected windows (cam_config) and sets
+*          FS_ETPU_CAM_ERROR_PHASE on mismatch, so a wrong or slipped engine
+*          phase is detected within one engine cycle. The errors are counted
+*          and, if cam_phase_resync is set, the CRANK is asked to restart
+*          the synchronization.
+*          It is called from etpu_cam_isr only, right after reading the CAM
+*          states, because reading the states clears the eTPU error flags.
+*          No other context reads the CAM states in full sync.
+*
+* @return  N/A
+*
+******************************************************************************/
+void cam_phase_check(void)
+{
+  if(cam_states.error & FS_ETPU_CAM_ERROR_PHASE)
+  {
+    cam_phase_errors++;
+    if(cam_phase_resync != 0)
+    {
+      fs_etpu_crank_resync(&crank_instance);
+    }
+  }
+}
+
+/***************************************************************************//*!
+*
+* @brief   Read the background task scheduler time.
+*
+* @return  Time [SCHED_TICKS_PER_MS ticks per ms].
+*
+******************************************************************************/
+static inline uint32_t sched_time(void)
+{
+#ifndef CPU32SIM
+  uint32_t tbl;
+
+  asm volatile("mfspr %0, 268" : "=r" (tbl));
+  return(tbl);
+#else
+  return((uint32_t)(uint64_t)read_time());
+#endif
+}
+
+/***************************************************************************//*!
+*
+* @brief   Initialize the background task scheduler.
+*
+* @note    The tasks are assigned their periods and all periodic tasks are
+*          released immediately.
+*
+* @return  N/A
+*
+******************************************************************************/
+void sched_init(void)
+{
+  struct sched_task_t *p;
+  uint32_t now;
+  uint32_t i;
+
+  sched_task[SCHED_TASK_1MS].p_func = sched_task_1ms;
+  sched_task[SCHED_TASK_1MS].period = SCHED_PERIOD_1MS*SCHED_TICKS_PER_MS;
+  sched_task[SCHED_TASK_10MS].p_func = sched_task_10ms;
+  sched_task[SCHED_TASK_10MS].period = SCHED_PERIOD_10MS*SCHED_TICKS_PER_MS;
+  sched_task[SCHED_TASK_CYCLE].p_func = sched_task_cycle;
+  sched_task[SCHED_TASK_CYCLE].period = SCHED_PERIOD_CYCLE;
+
+  now = sched_time();
+  for(i=0, p=&sched_task[0]; i<SCHED_TASK_COUNT; i++, p++)
+  {
+    p->release = now;
+    p->exec_time = 0;
+    p->exec_max = 0;
+    p->count = 0;
+    p->overruns = 0;
+  }
+  sched_cycle_served = sched_cycle_count;
+}
+
+/***************************************************************************//*!
+*
+* @brief   Run the background tasks which are due.
+*
+* @note    A cooperative scheduler - each task runs to completion. A periodic
+*          task is due when its release time has passed, the per-cycle task
+*          when the CRANK ISR has signalled a new engine cycle. A task
+*          overrun is counted when a release is missed, i.e. the task is
+*          late by a whole period or more than one engine cycle is pending.
+*          Then the task is run only once and released again one period
+*          later. The execution time of each run is measured.
+*
+* @return  N/A
+*
+******************************************************************************/
+void sched_run(void)
+{
+  struct sched_task_t *p;
+  uint32_t start;
+  uint32_t cycle_count;
+  uint32_t i;
+
+  for(i=0, p=&sched_task[0]; i<SCHED_TASK_COUNT; i++, p++)
+  {
+    start = sched_time();
+    if(p->period == 0)
+    {
+      cycle_count = sched_cycle_count;
+      if(cycle_count == sched_cycle_served) continue;
+      if(cycle_count - sched_cycle_served > 1) p->overruns++;
+      sched_cycle_served = cycle_count;
+    }
+    else
+    {
+      if((int32_t)(start - p->release) < 0) continue;
+      p->release += p->period;
+      if((int32_t)(start - p->release) >= 0)
+      {
+        p->overruns++;
+        p->release = start + p->period;
+      }
+    }
+
+    p->p_func();
+
+    p->exec_time = sched_time() - start;
+    if(p->exec_time > p->exec_max) p->exec_max = p->exec_time;
+    p->count++;
+  }
+}
+
+/***************************************************************************//*!
+*
+* @brief   1 ms background task - engine control outputs.
+*
+* @note    The injection time is updated by FreeMASTER or the simulation
+*          script, the TG engine speed by engine_speed_setpoint.
+*
+* @return  N/A
+*
+******************************************************************************/
+void sched_task_1ms(void)
+{
+  double current_time;
+
+  current_time = read_time();
+#ifdef CPU32SIM
+  fault_injection(current_time);
+  capacity_sweep(current_time);
+#endif
+  engine_speed_setpoint(current_time);
+
+  /* Set Fuel injection time - the value is updated in by FreeMASTER */
+  fs_etpu_fuel_update_injection_time(&fuel_1_instance, &fuel_config);
+
+  /* Interface TG eTPU function - this sets engine speed updated by FreeMASTER */
+  fs_etpu_tg_get_states(&tg_instance, &tg_states);
+#ifdef CPU32SIM
+  fs_etpu_tg_config(&tg_instance, fault_tg_config());
+#else
+  fs_etpu_tg_config(&tg_instance, &tg_config);
+#endif
+}
+
+/***************************************************************************//*!
+*
+* @brief   10 ms background task - engine position and speed refresh.
+*
+* @return  N/A
+*
+******************************************************************************/
+void sched_task_10ms(void)
+{
+  /* refresh current engine position */
+  engine_position = TCR22DEG(fs_etpu_crank_get_angle_reseting());
+  /* refresh current engine speed */
+  engine_speed = TP2RPM(crank_states.last_tooth_period_norm);
+}
+
+/***************************************************************************//*!
+*
+* @brief   Set the TG engine speed set-point.
+*
+* @note    Apart from FreeMASTER, this is the only writer of the TG
+*          tooth_period_target. The set-point source is selected by priority:
+*          - the capacity sweep, while it is running,
+*          - the co-simulation plant model, when cosim_engine_speed_rpm
+*            is set,
+*          - the closed-loop plant model, when plant_enable is set,
+*          - otherwise the built-in test profile, which steps the speed to
+*            2000 rpm at 60 ms and to 5000 rpm at 66 ms and then leaves it
+*            to FreeMASTER.
+*
+* @param   time - The current time in us.
+*
+* @return  N/A
+*
+******************************************************************************/
+void engine_speed_setpoint(double time)
+{
+  double speed_rpm = 0;
+
+#ifdef CPU32SIM
+  if (capacity_speed_rpm != 0)
+  {
+    speed_rpm = capacity_speed_rpm;
+  }
+  else if (cosim_engine_speed_rpm != 0)
+  {
+    speed_rpm = cosim_engine_speed_rpm;
+  }
+  else if (plant_enable != 0)
+  {
+    speed_rpm = plant_speed_rpm;
+  }
+#endif
+
+  if (speed_rpm != 0)
+  {
+    tg_config.tooth_period_target = RPM2TP(speed_rpm);
+  }
+  else if (test_step == 0 && time > 60000.0)
+  {
+    tg_config.tooth_period_target = RPM2TP(2000);
+    test_step = 1;
+  }
+  else if (test_step == 1 && time > 66000.0)
+  {
+    tg_config.tooth_period_target = RPM2TP(5000);
+    test_step = 2;
+  }
+}
+
+/***************************************************************************//*!
+*
+* @brief   Per engine cycle background task - Crank tooth period log.
+*
+* @note    The Crank and Cam states are not read here. Reading them clears
+*          the eTPU error flags, which are owned by etpu_crank_isr and
+*          etpu_cam_isr.
+*
+* @return  N/A
+*
+******************************************************************************/
+void sched_task_cycle(void)
+{
+  /* copy the tooth periods of the last engine cycle to see them in FreeMaster */
+  fs_etpu_crank_copy_tooth_period_log(&crank_instance, &etpu_tooth_period_log[0]);
+}
+
+#if ISR_PROFILING
+/***************************************************************************//*!
+*
+* @brief   Initialize ISR profiling.
+*
+* @note    The profiles are reset. The time base is enabled by
+*          time_base_init.
+*
+* @return  N/A
+*
+******************************************************************************/
+void isr_profile_init(void)
+{
+  uint32_t i;
+
+  for(i=0; i<ISR_PROFILE_COUNT; i++)
+  {
+    isr_profile[i].min = 0xFFFFFFFF;
+    isr_profile[i].max = 0;
+    isr_profile[i].avg = 0;
+    isr_profile[i].count = 0;
+    isr_profile[i].ring_idx = 0;
+    isr_profile[i].sum = 0;
+  }
+}
+
+/***************************************************************************//*!
+*
+* @brief   Read the time base lower register.
+*
+* @return  Time base lower 32 bits.
+*
+******************************************************************************/
+static inline uint32_t isr_profile_time(void)
+{
+  uint32_t tbl;
+
+  asm volatile("mfspr %0, 268" : "=r" (tbl));
+  return(tbl);
+}
+
+/***************************************************************************//*!
+*
+* @brief   Record an event into the ISR timeline trace.
+*
+* @note    The trace ring holds the last ISR_TRACE_SIZE ISR entry and exit
+*          events. Each event has the time, the ISR and the phase coded as in
+*          the trace-event format (B/E), so the ring read by FreeMASTER can
+*          be converted to a timeline viewable in trace viewers.
+*
+* @param   profile - ISR profile index, one of ISR_PROFILE_x.
+* @param   phase - ISR_TRACE_BEGIN or ISR_TRACE_END.
+* @param   time - Time base value of the event.
+*
+* @return  N/A
+*
+******************************************************************************/
+static inline void isr_trace_event(uint32_t profile, uint8_t phase, uint32_t time)
+{
+  struct isr_trace_event_t *p = &isr_trace[isr_trace_idx];
+
+  p->time = time;
+  p->profile = (uint8_t)profile;
+  p->phase = phase;
+  if(++isr_trace_idx >= ISR_TRACE_SIZE) isr_trace_idx = 0;
+}
+
+/***************************************************************************//*!
+*
+* @brief   ISR profiling - ISR entry.
+*
+* @param   profile - ISR profile index, one of ISR_PROFILE_x.
+*
+* @return  N/A
+*
+******************************************************************************/
+void isr_profile_entry(uint32_t profile)
+{
+  isr_profile[profile].entry_time = isr_profile_time();
+  isr_trace_event(profile, ISR_TRACE_BEGIN, isr_profile[profile].entry_time);
+}
+
+/***************************************************************************//*!
+*
+* @brief   ISR profiling - ISR exit.
+*
+* @note    The ISR execution time is stored into the ring of the last
+*          execution times, and the min/max/avg are updated. All eTPU ISRs
+*          are installed with the same priority, so they do not preempt
+*          each other.
+*
+* @param   profile - ISR profile index, one of ISR_PROFILE_x.
+*
+* @return  N/A
+*
+******************************************************************************/
+void isr_profile_exit(uint32_t profile)
+{
+  struct isr_profile_t *p = &isr_profile[profile];
+  uint32_t time;
+
+  time = isr_profile_time();
+  isr_trace_event(profile, ISR_TRACE_END, time);
+  time -= p->entry_time;
+
+  /* The sum covers the last ISR_PROFILE_RING_SIZE execution times */
+  p->sum -= p->ring[p->ring_idx];
+  p->sum += time;
+  p->ring[p->ring_idx] = time;
+  if(++p->ring_idx >= ISR_PROFILE_RING_SIZE) p->ring_idx = 0;
+  if(p->count < ISR_PROFILE_RING_SIZE)
+  {
+    p->avg = p->sum/(p->count + 1);
+  }
+  else
+  {
+    p->avg = p->sum/ISR_PROFILE_RING_SIZE;
+  }
+  p->count++;
+  if(time < p->min) p->min = time;
+  if(time > p->max) p->max = time;
+}
+#endif
+
+#ifdef CPU32SIM
+/***************************************************************************//*!
+*
+* @brief   Closed-loop engine plant model - cylinder combustion event.
+*
+* @note    A simple mean-value model with cylinder torque pulses. Between
+*          the events the engine speed decreases due to the load and
+*          friction. Each combustion adds a speed step proportional to
+*          the injection time. No spark (dwell_time = 0) means a misfire
+*          and no torque. The resulting speed is fed back to the crank
+*          signal by TG, see engine_speed_setpoint.
+*
+* @param   injection_time - The applied injection time of the cylinder
+*                           as a number of TCR1 ticks.
+* @param   dwell_time - The applied spark dwell time of the cylinder
+*                       as a number of TCR1 ticks.
+*
+* @return  N/A
+*
+******************************************************************************/
+void plant_cylinder_event(uint24_t injection_time, uint24_t dwell_time)
+{
+  static double last_time = 0;
+  double time;
+  double dt;
+
+  time = read_time();
+  dt = (time - last_time)/1E6;
+  last_time = time;
+  if (plant_enable == 0) return;
+
+  /* load and friction since the last event */
+  plant_speed_rpm -= (PLANT_LOAD_RPM_PER_SEC
+                      + PLANT_FRICTION_PER_SEC*plant_speed_rpm)*dt;
+  /* cylinder torque */
+  if (dwell_time != 0)
+  {
+    plant_speed_rpm += PLANT_RPM_PER_INJ_USEC*injection_time*1E6/TCR1_FREQ_HZ;
+  }
+
+  if (plant_speed_rpm < PLANT_SPEED_MIN_RPM) plant_speed_rpm = PLANT_SPEED_MIN_RPM;
+  if (plant_speed_rpm > PLANT_SPEED_MAX_RPM) plant_speed_rpm = PLANT_SPEED_MAX_RPM;
+}
+
+/***************************************************************************//*!
+*
+* @brief   Apply and remove simulated faults.
+*
+* @note    A fault is applied on fault_request, written by the simulation
+*          script at a scheduled time, or randomly when fault_seed is set.
+*          The random faults are generated by a linear congruential
+*          generator, so a seed always gives the same fault sequence.
+*          Each fault lasts fault_duration_us:
+*          - FAULT_CRANK_DROPOUT - TG generation is disabled, so there are
+*            missing teeth and no crank/cam signal for the fault duration,
+*          - FAULT_ISR_DELAY - the CRANK ISR service is delayed by
+*            fault_isr_delay_us,
+*          - FAULT_TOOTH_NOISE, FAULT_EXTRA_TEETH - the TG tooth period is
+*            disturbed, see fault_tg_config,
+*          - FAULT_DATA_RAM - on the fault start, the CRANK tooth_counter_cycle
+*            in eTPU DATA RAM is advanced by half an engine cycle, so the
+*            engine cycle restarts on the wrong gap and the engine phase slips
+*            by 360 degrees. The CAM phase check detects it, if enabled by
+*            cam_config.window_count in etpu_gct.c.
+*          Narrow glitch pulses between two teeth are not simulated - the TG
+*          generates whole tooth periods only.
+*
+* @param   time - The current time in us.
+*
+* @return  N/A
+*
+******************************************************************************/
+void fault_injection(double time)
+{
+  static double fault_end_time = 0;
+  static double random_fault_time = 0;
+  static uint32_t lcg = 0;
+  uint8_t *p_counter;
+
+  if((fault_seed != 0) && (lcg == 0))
+  {
+    lcg = fault_seed;
+    random_fault_time = time;
+  }
+  if((lcg != 0) && (fault_active == FAULT_NONE) && (time >= random_fault_time))
+  {
+    lcg = lcg*1103515245 + 12345;
+    fault_request = FAULT_CRANK_DROPOUT << ((lcg >> 16) % FAULT_CLASS_COUNT);
+    lcg = lcg*1103515245 + 12345;
+    random_fault_time = time + fault_duration_us + FAULT_RANDOM_PERIOD_MIN_US
+      + (lcg >> 8) % (FAULT_RANDOM_PERIOD_MAX_US - FAULT_RANDOM_PERIOD_MIN_US);
+  }
+
+  if(fault_request != FAULT_NONE)
+  {
+    fault_active = fault_request;
+    fault_request = FAULT_NONE;
+    fault_end_time = time + fault_duration_us;
+    fault_recovery_check(0xFF);
+    if(fault_active & FAULT_DATA_RAM)
+    {
+      /* the host writes the eTPU DATA RAM like a stray pointer would */
+      p_counter = (uint8_t*)crank_instance.cpba + FS_ETPU_CRANK_OFFSET_TOOTH_COUNTER_CYCLE;
+      *p_counter += TEETH_PER_CYCLE/2;
+    }
+  }
+  else if((fault_active != FAULT_NONE) && (time >= fault_end_time))
+  {
+    fault_active = FAULT_NONE;
+  }
+}
+
+/***************************************************************************//*!
+*
+* @brief   Return the TG configuration with the active TG faults applied.
+*
+* @note    tg_config is owned by the engine speed set-point, so the faults
+*          are applied to a copy of it which is written to the TG instead:
+*          - FAULT_CRANK_DROPOUT - the generation is disabled,
+*          - FAULT_TOOTH_NOISE - the tooth period is randomly changed by up
+*            to FAULT_NOISE_PCT on each update, from the next tooth on,
+*          - FAULT_EXTRA_TEETH - the tooth period is halved from the next
+*            tooth on, so a tooth comes in the middle of each tooth period
+*            the CRANK expects and the gaps come early.
+*
+* @return  A pointer to the TG configuration to write.
+*
+******************************************************************************/
+struct tg_config_t *fault_tg_config(void)
+{
+  static struct tg_config_t tg_config_fault;
+  static uint32_t lcg = 1;
+  int32_t noise_pct;
+
+  if((fault_active & (FAULT_CRANK_DROPOUT | FAULT_TOOTH_NOISE
+                     | FAULT_EXTRA_TEETH)) == 0)
+  {
+    return(&tg_config);
+  }
+
+  tg_config_fault = tg_config;
+  if(fault_active & FAULT_CRANK_DROPOUT)
+  {
+    tg_config_fault.generation_disable = FS_ETPU_TG_GENERATION_DISABLED;
+  }
+  if(fault_active & FAULT_TOOTH_NOISE)
+  {
+    lcg = lcg*1103515245 + 12345;
+    noise_pct = (int32_t)((lcg >> 16) % (2*FAULT_NOISE_PCT + 1)) - FAULT_NOISE_PCT;
+    tg_config_fault.tooth_period_target += tg_config.tooth_period_target/100*noise_pct;
+    tg_config_fault.accel_ratio = UFRACT24(1.0);
+  }
+  if(fault_active & FAULT_EXTRA_TEETH)
+  {
+    tg_config_fault.tooth_period_target >>= 1;
+    tg_config_fault.accel_ratio = UFRACT24(1.0);
+  }
+  return(&tg_config_fault);
+}
+
+/***************************************************************************//*!
+*
+* @brief   Measure the time to recover to FULL_SYNC after a fault.
+*
+* @note    The recovery time is measured from the fault start to the first
+*          FULL_SYNC after the synchronization was lost. A fault which does
+*          not cause a loss of synchronization is not measured.
+*
+* @param   eng_pos_state - The current engine position state,
+*                          0xFF on fault start.
+*
+* @return  N/A
+*
+******************************************************************************/
+void fault_recovery_check(uint8_t eng_pos_state)
+{
+  static double fault_start_time;
+  static uint8_t fault_pending = 0;
+  static uint8_t sync_lost = 0;
+
+  if(eng_pos_state == 0xFF)
+  {
+    fault_start_time = read_time();
+    fault_pending = 1;
+    sync_lost = 0;
+  }
+  else if(fault_pending != 0)
+  {
+    if(eng_pos_state != FS_ETPU_ENG_POS_FULL_SYNC)
+    {
+      sync_lost = 1;
+    }
+    else if(sync_lost != 0)
+    {
+      fault_recovery_time_us = (uint32_t)(read_time() - fault_start_time);
+      if(fault_recovery_time_us > fault_recovery_time_max_us)
+      {
+        fault_recovery_time_max_us = fault_recovery_time_us;
+      }
+      fault_pending = 0;
+    }
+  }
+}
+
+/***************************************************************************//*!
+*
+* @brief   Convert the worst-case CRANK tooth service latency to us.
+*
+* @note    The eTPU tooth_latency_max is a free-running maximum since
+*          the CRANK initialization, it is only converted to us here.
+*
+* @param   tooth_latency - The CRANK tooth_latency_max as a number of TCR1
+*                          ticks.
+*
+* @return  N/A
+*
+******************************************************************************/
+void tooth_latency_check(uint24_t tooth_latency)
+{
+  tooth_latency_max_us = (uint32_t)(tooth_latency*1E6/TCR1_FREQ_HZ);
+}
+
+/***************************************************************************//*!
+*
+* @brief   Sum the SPARK and FUEL output edges in the worst lateness bucket.
+*
+* @return  Count of edges.
+*
+******************************************************************************/
+static uint32_t capacity_late_edge_count(void)
+{
+  return(spark_1_states.lateness_hist[FS_ETPU_LATENESS_BUCKET_COUNT-1]
+       + spark_2_states.lateness_hist[FS_ETPU_LATENESS_BUCKET_COUNT-1]
+       + spark_3_states.lateness_hist[FS_ETPU_LATENESS_BUCKET_COUNT-1]
+       + spark_4_states.lateness_hist[FS_ETPU_LATENESS_BUCKET_COUNT-1]
+       + fuel_1_states.lateness_hist[FS_ETPU_LATENESS_BUCKET_COUNT-1]
+       + fuel_2_states.lateness_hist[FS_ETPU_LATENESS_BUCKET_COUNT-1]
+       + fuel_3_states.lateness_hist[FS_ETPU_LATENESS_BUCKET_COUNT-1]
+       + fuel_4_states.lateness_hist[FS_ETPU_LATENESS_BUCKET_COUNT-1]);
+}
+
+/***************************************************************************//*!
+*
+* @brief   Sweep the engine speed and record the eTPU capacity curve.
+*
+* @note    When capacity_sweep_enable is set, the TG engine speed is stepped
+*          from CAPACITY_RPM_START by CAPACITY_RPM_STEP, each step lasting
+*          CAPACITY_STEP_TIME_US. For each step the maximum eTPU engine A
+*          load (100 - idle percentage) and the count of SPARK and FUEL
+*          output edges in the worst lateness bucket are recorded.
+*          The lowest rpm with late edges or with the load over
+*          CAPACITY_LOAD_LIMIT_PCT is the predicted breaking point.
+*          Only the total engine load is available from the idle counter,
+*          the load is not split per eTPU function.
+*          The step speed is passed by capacity_speed_rpm to
+*          engine_speed_setpoint, where it overrides the other set-point
+*          sources until the sweep is done.
+*
+* @param   time - The current time in us.
+*
+* @return  N/A
+*
+******************************************************************************/
+void capacity_sweep(double time)
+{
+  static uint32_t step = 0;
+  static double step_end_time;
+  static uint32_t late_edges_start;
+
+  if((capacity_sweep_enable == 0) || (capacity_sweep_done != 0)) return;
+
+  if(capacity_rpm[0] == 0)
+  {
+    /* Start the sweep */
+    capacity_break_rpm = 0;
+    capacity_rpm[step] = CAPACITY_RPM_START;
+    capacity_speed_rpm = capacity_rpm[step];
+    step_end_time = time + CAPACITY_STEP_TIME_US;
+    late_edges_start = capacity_late_edge_count();
+  }
+
+  if(etpu_engine_load > capacity_load[step])
+  {
+    capacity_load[step] = etpu_engine_load;
+  }
+
+  if(time >= step_end_time)
+  {
+    /* Finish the step */
+    capacity_late_edges[step] = capacity_late_edge_count() - late_edges_start;
+    if((capacity_break_rpm == 0)
+       && ((capacity_late_edges[step] != 0)
+           || (capacity_load[step] > CAPACITY_LOAD_LIMIT_PCT)))
+    {
+      capacity_break_rpm = capacity_rpm[step];
+    }
+
+    /* Next step */
+    if(++step >= CAPACITY_STEP_COUNT)
+    {
+      capacity_sweep_done = 1;
+      capacity_speed_rpm = 0;
+      return;
+    }
+    capacity_rpm[step] = capacity_rpm[step-1] + CAPACITY_RPM_STEP;
+    capacity_speed_rpm = capacity_rpm[step];
+    step_end_time = time + CAPACITY_STEP_TIME_US;
+    late_edges_start = capacity_late_edge_count();
+  }
+}
+#endif
+
 /*******************************************************************************
  *
  * Copyright:
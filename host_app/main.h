@@ -27,5 +27,50 @@
 #define TEST_PAD_KNOCK     FS_GPIO_ETPUA30
 #define TEST_PAD_INJ       FS_GPIO_ETPUA31
 
+/******************************************************************************
+* ISR profiling
+******************************************************************************/
+/* Set ISR_PROFILING to 1 in order to measure the ISR execution times using
+   the time base, instead of toggling the TEST_PADs for a scope. */
+#define ISR_PROFILING                0
+/* Count of the last ISR execution times kept per ISR */
+#define ISR_PROFILE_RING_SIZE       16
+/* Count of the last ISR entry/exit events kept in the timeline trace */
+#define ISR_TRACE_SIZE             256
+/* ISR timeline trace event phases - as in the trace-event format */
+#define ISR_TRACE_BEGIN            'B'
+#define ISR_TRACE_END              'E'
+
+/* ISR profile indexes - one per TEST_PAD */
+#define ISR_PROFILE_TG               0
+#define ISR_PROFILE_CRANK            1
+#define ISR_PROFILE_CAM              2
+#define ISR_PROFILE_SPARK            3
+#define ISR_PROFILE_FUEL             4
+#define ISR_PROFILE_KNOCK            5
+#define ISR_PROFILE_INJ              6
+#define ISR_PROFILE_COUNT            7
+
+#if ISR_PROFILING
+#define ISR_ENTRY(profile, pad)      isr_profile_entry(profile)
+#define ISR_EXIT(profile, pad)       isr_profile_exit(profile)
+#else
+#define ISR_ENTRY(profile, pad)      fs_gpio_write_data(pad, 1)
+#define ISR_EXIT(profile, pad)       fs_gpio_write_data(pad, 0)
+#endif
+
+/******************************************************************************
+* Background task scheduler
+******************************************************************************/
+/* Task indexes, in the order of execution within a background loop pass */
+#define SCHED_TASK_1MS               0
+#define SCHED_TASK_10MS              1
+#define SCHED_TASK_CYCLE             2
+#define SCHED_TASK_COUNT             3
+/* Task periods [ms], 0 = once per engine cycle released by the CRANK ISR */
+#define SCHED_PERIOD_1MS             1
+#define SCHED_PERIOD_10MS           10
+#define SCHED_PERIOD_CYCLE           0
+
 
 #endif /* _MAIN_H_ */
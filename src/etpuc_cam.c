@@ -17,6 +17,9 @@
 *    This eTPU function logs TCR2 values (engine angles) captured on input
 *    transitions into an array. This log can be used e.g. to recognize between  
 *    engine half-cycle 0-360 or 360-720. 
+*    In full sync, the log of each engine cycle can be checked against
+*    expected windows in order to detect a wrong or slipped engine phase
+*    within one engine cycle.
 *
 *******************************************************************************/
 
@@ -40,18 +43,107 @@
 *                  to. It is reset to zero on a link (from Crank).
 *   log_count    - number of logs during the last log cycle (cam_log_idx is
 *                  copied to cam_log_count before resetting).   
+*   reset_count  - number of log resets, incremented (modulo 256) together
+*                  with resetting log_idx. It enables the CPU to recognize
+*                  a log reset when reading the log incrementally.
 *   error        - Error status bits. Any time a bit is set, the channel IRQ is
 *                  raised. Written by eTPU, cleared by CPU.
+*   window_count - number of expected transitions in an engine cycle, the size
+*                  of the window array. 0 disables the phase check.
+*   window       - array of expected transitions. Each window consist of
+*                  - expected transition polarity (0-falling, 1-rising),
+*                  - window start angle, relative to the engine cycle start,
+*                  - window angle width.
 *
 ********************************************************************************
 *
 *  Channel Flag usage
 *    Flag0 is not used.
-*    Flag1 is not used.
+*    Flag1 is used to arm the phase check after the first engine cycle in
+*      full sync, because the log of that cycle includes transitions captured
+*      before the TCR2 angle adjustment:
+*      - CAM_FLAG1_CHECK_NOT_ARMED
+*      - CAM_FLAG1_CHECK_ARMED
 *
 *******************************************************************************/
 
 
+/*******************************************************************************
+*  FUNCTION NAME: PhaseCheck
+*  DESCRIPTION: Compare the log of the last engine cycle to the expected
+*    windows. The count of transitions must match window_count, the first
+*    transition must lie in one of the windows and each next transition in
+*    the next window (cyclically), with the expected polarity.
+*    The windows are sorted by angle and must not span the engine cycle start.
+*    On mismatch, set CAM_ERROR_PHASE and IRQ.
+*******************************************************************************/
+void CAM::PhaseCheck(void)
+{
+	struct CAM_LOG    *p_log;
+	struct CAM_WINDOW *p_window;
+	struct CAM_WINDOW *p_window_end;
+	uint24_t cycle_start;
+	uint24_t angle;
+	uint8_t  i;
+
+	/* eng_cycle_tcr2_start is the end of the current engine cycle and the
+	   Crank link is sent after it has been moved to the next cycle */
+	cycle_start = eng_cycle_tcr2_start - (eng_cycle_tcr2_ticks << 1);
+	p_window_end = window + window_count;
+
+	/* find the window of the first logged transition */
+	p_log = log;
+	angle = p_log->angle - cycle_start;
+	if(angle >= eng_cycle_tcr2_ticks)
+	{
+		angle -= eng_cycle_tcr2_ticks;
+	}
+	p_window = window;
+	i = window_count;
+	while(i > 0)
+	{
+		if((p_log->trans == p_window->trans)
+		 && ((uint24_t)(angle - p_window->angle_start) < p_window->angle_width))
+		{
+			break;
+		}
+		p_window++;
+		i--;
+	}
+
+	if((i == 0) || (log_count != window_count))
+	{
+		error |= CAM_ERROR_PHASE;
+		channel.CIRC = CIRC_INT_FROM_SERVICED;
+	}
+	else
+	{
+		/* check the next transitions against the next windows */
+		for(i = window_count - 1; i > 0; i--)
+		{
+			p_log++;
+			p_window++;
+			if(p_window == p_window_end)
+			{
+				p_window = window;
+			}
+			angle = p_log->angle - cycle_start;
+			if(angle >= eng_cycle_tcr2_ticks)
+			{
+				angle -= eng_cycle_tcr2_ticks;
+			}
+			if((p_log->trans != p_window->trans)
+			 || ((uint24_t)(angle - p_window->angle_start) >= p_window->angle_width))
+			{
+				error |= CAM_ERROR_PHASE;
+				channel.CIRC = CIRC_INT_FROM_SERVICED;
+				break;
+			}
+		}
+	}
+}
+
+
 /*******************************************************************************
 *  eTPU Function
 *******************************************************************************/
@@ -110,6 +202,9 @@ _eTPU_thread CAM::INIT(_eTPU_matches_disabled)
 	channel.OPACA = OPAC_NO_CHANGE;
 	channel.OPACB = OPAC_NO_CHANGE;
 
+	/* Channel flags */
+	channel.FLAG1 = CAM_FLAG1_CHECK_NOT_ARMED;
+
 	/* Enable event handling */
 	channel.MTD = MTD_ENABLE;	
 }
@@ -118,11 +213,14 @@ _eTPU_thread CAM::INIT(_eTPU_matches_disabled)
 * THREAD NAME: RESET
 * DESCRIPTION: Reset the log. Test if count == 0.
 *              The link from Cam is expected once per cycle.	
+*              In full sync, check the log against the expected windows,
+*              starting from the second engine cycle.
 **************************************************************************/
 _eTPU_thread CAM::RESET(_eTPU_matches_enabled)
 {
 	log_count = log_idx;
 	log_idx = 0;
+	reset_count++;
 	channel.LSR = LSR_CLEAR;
 	
 	if(log_count == 0)
@@ -131,6 +229,19 @@ _eTPU_thread CAM::RESET(_eTPU_matches_enabled)
 	  error |= CAM_ERROR_ZERO_TRANS;
 	  channel.CIRC = CIRC_INT_FROM_SERVICED;
 	}
+
+	if((window_count != 0) && (eng_pos_state == ENG_POS_FULL_SYNC))
+	{
+		if(channel.FLAG1 == CAM_FLAG1_CHECK_ARMED)
+		{
+			PhaseCheck();
+		}
+		channel.FLAG1 = CAM_FLAG1_CHECK_ARMED;
+	}
+	else
+	{
+		channel.FLAG1 = CAM_FLAG1_CHECK_NOT_ARMED;
+	}
 }
 
 /**************************************************************************
@@ -144,13 +255,16 @@ _eTPU_thread CAM::LOG_1_TRANS(_eTPU_matches_enabled)
 	channel.TDL = TDL_CLEAR;			
 	if(log_idx < log_size)
 	{
-		ptr = log + log_idx++;
+		/* log_idx is incremented after the log item is written, so that
+		   the CPU never reads a log item which is not written yet */
+		ptr = log + log_idx;
 		ptr->trans = CAM_FALLING;
 		if(channel.PSS == 1)
 		{
 			ptr->trans = CAM_RISING;
 		}
 		ptr->angle = erta;
+		log_idx++;
 	}
 	else
 	{
@@ -173,7 +287,7 @@ _eTPU_thread CAM::LOG_2_TRANS(_eTPU_matches_enabled)
 	channel.TDL = TDL_CLEAR;			
 	if(log_idx < log_size)
 	{
-		ptr = log + log_idx++;
+		ptr = log + log_idx;
 	  ptr->trans = CAM_FALLING;
 #if defined(__TARGET_ETPU1__)
 	  if(channel.PSS == 1)
@@ -184,10 +298,10 @@ _eTPU_thread CAM::LOG_2_TRANS(_eTPU_matches_enabled)
 		  ptr->trans = CAM_RISING;
 		}
 	  ptr->angle = erta;
+		log_idx++;
 
 		if(log_idx < log_size)
 		{
-			log_idx++;
 			ptr++;
 		  ptr->trans = CAM_FALLING;
 		  if(channel.PSS == 1)
@@ -195,6 +309,7 @@ _eTPU_thread CAM::LOG_2_TRANS(_eTPU_matches_enabled)
 			  ptr->trans = CAM_RISING;
 			}
 		  ptr->angle = ertb;
+			log_idx++;
 		}
 		else
 		{
@@ -303,7 +418,10 @@ DEFINE_ENTRY_TABLE(CAM, CAM, standard, inputpin, autocfsr)
 #pragma write h, (::ETPUliteral(#define FS_ETPU_CAM_OFFSET_LOG_SIZE  ) ::ETPUlocation (CAM, log_size ) );
 #pragma write h, (::ETPUliteral(#define FS_ETPU_CAM_OFFSET_LOG_IDX   ) ::ETPUlocation (CAM, log_idx  ) );
 #pragma write h, (::ETPUliteral(#define FS_ETPU_CAM_OFFSET_LOG_COUNT ) ::ETPUlocation (CAM, log_count) );
+#pragma write h, (::ETPUliteral(#define FS_ETPU_CAM_OFFSET_RESET_COUNT) ::ETPUlocation (CAM, reset_count) );
 #pragma write h, (::ETPUliteral(#define FS_ETPU_CAM_OFFSET_ERROR     ) ::ETPUlocation (CAM, error    ) );
+#pragma write h, (::ETPUliteral(#define FS_ETPU_CAM_OFFSET_WINDOW_COUNT) ::ETPUlocation (CAM, window_count) );
+#pragma write h, (::ETPUliteral(#define FS_ETPU_CAM_OFFSET_WINDOW     ) ::ETPUlocation (CAM, window   ) );
 #pragma write h, ( );
 #pragma write h, (/* Cam Log */);
 #pragma write h, (::ETPUliteral(#define FS_ETPU_CAM_LOG_ANGLE_MASK    ) 0x00FFFFFF );
@@ -311,10 +429,19 @@ DEFINE_ENTRY_TABLE(CAM, CAM, standard, inputpin, autocfsr)
 #pragma write h, (::ETPUliteral(#define FS_ETPU_CAM_LOG_TRANS_FALLING ) (CAM_FALLING<<24) );
 #pragma write h, (::ETPUliteral(#define FS_ETPU_CAM_LOG_TRANS_RISING  ) (CAM_RISING<<24) );
 #pragma write h, ( );
+#pragma write h, (/* Cam Window Structure */);
+#pragma write h, (::ETPUliteral(#define FS_ETPU_CAM_WINDOW_OFFSET_TRANS ) 0x00 );
+#pragma write h, (::ETPUliteral(#define FS_ETPU_CAM_WINDOW_OFFSET_START ) 0x01 );
+#pragma write h, (::ETPUliteral(#define FS_ETPU_CAM_WINDOW_OFFSET_WIDTH ) 0x05 );
+#pragma write h, (::ETPUliteral(#define FS_ETPU_CAM_WINDOW_STRUCT_SIZE  ) 0x08 );
+#pragma write h, (::ETPUliteral(#define FS_ETPU_CAM_WINDOW_FALLING      ) CAM_FALLING );
+#pragma write h, (::ETPUliteral(#define FS_ETPU_CAM_WINDOW_RISING       ) CAM_RISING  );
+#pragma write h, ( );
 #pragma write h, (/* Errors */);
 #pragma write h, (::ETPUliteral(#define FS_ETPU_CAM_ERROR_NO           ) CAM_ERROR_NO           );
 #pragma write h, (::ETPUliteral(#define FS_ETPU_CAM_ERROR_ZERO_TRANS   ) CAM_ERROR_ZERO_TRANS   );
 #pragma write h, (::ETPUliteral(#define FS_ETPU_CAM_ERROR_LOG_OVERFLOW ) CAM_ERROR_LOG_OVERFLOW );
+#pragma write h, (::ETPUliteral(#define FS_ETPU_CAM_ERROR_PHASE        ) CAM_ERROR_PHASE        );
 #pragma write h, ( );
 #pragma write h, (#endif );
 
@@ -353,6 +480,11 @@ DEFINE_ENTRY_TABLE(CAM, CAM, standard, inputpin, autocfsr)
 *  REVISION HISTORY:
 *
 *  FILE OWNER: Milan Brejl [r54529]
+*  Revision 1.1  2026/10/18
+*  Phase check of the Cam log against expected windows in full sync added.
+*  Parameter reset_count added for incremental log reads, log_idx is
+*  incremented after the log item is written.
+*
 *  Revision 1.0  2014/03/16  r54529
 *  Minor comment and formating improvements. MISRA compliancy check.
 *  Ready for eTPU Engine Control Library release 1.0.
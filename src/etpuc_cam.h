@@ -23,6 +23,10 @@
 #define CAM_FM0_LOG_FALLING           1
 #define CAM_FM1_LOG_RISING            1
 
+/* Channel Flag1 - phase check armed after the first cycle in full sync */
+#define CAM_FLAG1_CHECK_NOT_ARMED     0
+#define CAM_FLAG1_CHECK_ARMED         1
+
 /* Cam log transition types */
 #define CAM_FALLING                   0
 #define CAM_RISING                    1
@@ -34,6 +38,8 @@
                                             last 2 resets (links) */
 #define CAM_ERROR_LOG_OVERFLOW        2  /* log array is too small to log all 
                                             transitions */
+#define CAM_ERROR_PHASE               4  /* logged transitions do not match
+                                            the expected windows */
 
 /* Data Structure Types */
 typedef struct CAM_LOG
@@ -42,6 +48,14 @@ typedef struct CAM_LOG
 	uint24_t angle;     /* TCR2 counter value captured */
 };
 
+typedef struct CAM_WINDOW
+{
+	  int8_t trans;       /* expected transition: 0-falling, 1-rising */
+	uint24_t angle_start; /* window start, relative to the engine cycle start */
+	  int8_t reserved;
+	uint24_t angle_width; /* window width */
+};
+
 /* CAM eTPU function class declaration */
 _eTPU_class CAM
 {
@@ -51,7 +65,10 @@ public:
 	      uint24_t log_idx;
 	      uint24_t log_count;
 	      uint8_t  error;
+	      uint8_t  reset_count;
 	const struct CAM_LOG *log;
+	const uint8_t  window_count;
+	const struct CAM_WINDOW *window;
 
 
     /************************************/
@@ -68,7 +85,7 @@ public:
     
     /* methods and fragments */
     
-    /* none */
+    void PhaseCheck(void);
     
     
     /************************************/
@@ -116,6 +133,10 @@ public:
 *  REVISION HISTORY:
 *
 *  FILE OWNER: Milan Brejl [r54529]
+*  Revision 1.1  2026/10/18
+*  Parameters window_count and window added for the phase check.
+*  Parameter reset_count added for incremental log reads.
+*
 *  Revision 1.0  2014/03/05  r54529
 *  Minor comment and formating improvements. MISRA compliancy check.
 *  Ready for eTPU Engine Control Library release 1.0.
@@ -85,12 +85,29 @@
 *                            the tooth following a timeout condition
 *   first_tooth_timeout    - TCR1 time after the first tooth (after blank_teeth)
 *                            when a timeout will be deemed to have happened
+*   stall_decel_ratio      - fraction used to detect a decelerating tooth for
+*                            the stall prediction:
+*                              tooth_period > (1 + stall_decel_ratio) *
+*                                             last_tooth_period
+*                            It must be lower than win_ratio_normal, otherwise
+*                            a decelerating tooth falls out of the window.
+*   stall_decel_teeth      - number of consecutive decelerating teeth which
+*                            predicts a stall. 0 disables the stall prediction.
+*   stall_decel_count      - count of consecutive decelerating teeth
+*   stall_predicted_count  - count of stalls declared by the stall prediction
 *   link_cam               - set of 4 link numbers to send to reset the Cam log
 *                            (up to 4 Cam channel numbers)
 *   link_1                 - the first  set of 4 link numbers to send on stall
 *   link_2                 - the second set of 4 link numbers to send on stall
 *   link_3                 - the third  set of 4 link numbers to send on stall
 *   link_4                 - the fourth set of 4 link numbers to send on stall
+*   link_extra_count       - the count of additional sets of 4 link numbers
+*                            to send on stall
+*   *link_extra            - pointer to an array of link_extra_count
+*                            additional sets of 4 link numbers
+*   link_deferred_idx      - index of the next set of 4 link numbers to send
+*                            from LINKS_DEFERRED (0 - link_3, 1 - link_4,
+*                            2 and above - link_extra)
 *   state                  - used to keep track of the CRANK state. See header
 *                            file for possible values.
 *   error                  - crank error flags. See header file for individual
@@ -99,7 +116,8 @@
 *   *tooth_period_log      - pointer to an array of tooth periods.
 *                            The array must include teeth_per_cycle items.
 *   err2477_tcr2_target    - used to keep track of when the Angle Counter is not
-*                            in high rate mode for errata 2477 workaround
+*                            in high rate mode for errata 2477 workaround.
+*                            Used by a crank wheel with gap(s) only.
 *
 ********************************************************************************
 *
@@ -162,6 +180,9 @@ uint8_t   eng_pos_state;
 const uint24_t  eng_cycle_tcr2_ticks = 0; /* initilaized by host driver */
 uint24_t  eng_cycle_tcr2_start;
 uint24_t  eng_trr_norm = 0xffffff;
+uint24_t  eng_tooth_period = 0xffffff;
+int24_t   eng_tooth_period_change = 0;
+const uint24_t  eng_trr_norm_highres = 0; /* initilaized by host driver */
 
 
 /*******************************************************************************
@@ -313,6 +334,47 @@ int24_t CRANK_Time_to_Angle_LowRes(
     return (time / (uint24_t)(eng_trr_norm >> 6)) << 3;
 }
 
+/*******************************************************************************
+*  FUNCTION NAME: CRANK_Time_to_Angle_Adaptive
+*  DESCRIPTION: Converts a time in TCR1 ticks to an angle value, using the current
+*    angle velocity.  The precision is selected by the engine speed: the HighRes
+*    version is used while eng_trr_norm >= eng_trr_norm_highres (low rpm), the
+*    LowRes version above, where its resolution is still fine in degrees and
+*    the eTPU load is at its peak.  eng_trr_norm_highres = 0 selects HighRes
+*    always.
+*******************************************************************************/
+int24_t CRANK_Time_to_Angle_Adaptive(
+    register_a uint24_t time)
+{
+    if (eng_trr_norm >= eng_trr_norm_highres)
+    {
+        return CRANK_Time_to_Angle_HighRes(time);
+    }
+    else
+    {
+        return CRANK_Time_to_Angle_LowRes(time);
+    }
+}
+
+/*******************************************************************************
+*  FUNCTION NAME: CRANK_Is_Accelerating
+*  DESCRIPTION: Returns TRUE if the last tooth period change, in absolute value,
+*    is at least accel_ratio of the tooth period, i.e. the engine accelerates
+*    or decelerates enough for an extra start angle recalculation to pay off.
+*    accel_ratio = 0 returns TRUE always.
+*******************************************************************************/
+_Bool CRANK_Is_Accelerating(
+    register_a ufract24_t accel_ratio)
+{
+    int24_t change = eng_tooth_period_change;
+
+    if (change < 0)
+    {
+        change = -change;
+    }
+    return ((uint24_t)change >= muliur(eng_tooth_period, accel_ratio));
+}
+
 
 /*******************************************************************************
 *  eTPU Class Methods/Fragments
@@ -423,13 +485,16 @@ _eTPU_fragment CRANK::Stall_NoReturn(void)
     eng_pos_state = ENG_POS_SEEK;
     /* Channel interrupt */
     channel.CIRC = CIRC_INT_FROM_SERVICED;
-    /* signal other functions that crank restarts */
+    /* signal other functions that crank restarts - the critical links
+       first, the rest is sent from the LINKS_DEFERRED thread */
     Link4(link_1);
     Link4(link_2);
-    Link4(link_3);
-    Link4(link_4);
+    link_deferred_idx = 0;
+    link = chan;
     /* set default values */
     eng_trr_norm = trr = 0xffffff;
+    eng_tooth_period = 0xffffff;
+    eng_tooth_period_change = 0;
     tpr = 0;
     /* reset TCR2 if it is in a range that could cause immediate macthes to occur when
        dependent channels (fuel, spark, etc.) re-initialize, otherwise it will be reset
@@ -445,6 +510,7 @@ _eTPU_fragment CRANK::Stall_NoReturn(void)
     last_tooth_tcr1_time = 0;
     last_tooth_period = 0;
     last_tooth_period_norm = 0;
+    stall_decel_count = 0;
     /* open the acceptance window immediately and do not close it */
     erta = tcr1;
     channel.MRLA = MRL_CLEAR;
@@ -497,9 +563,58 @@ void CRANK::ToothArray_Log(
     }
 }
 
+/*******************************************************************************
+*  FUNCTION NAME: ToothLatency_Log
+*  DESCRIPTION: Record the worst-case latency of the tooth transition service,
+*    measured from the transition capture to the start of the service.
+*    The maximum is free-running since INIT, the CPU only reads it.
+*******************************************************************************/
+void CRANK::ToothLatency_Log(void)
+{
+    uint24_t latency;
+
+    latency = tcr1 - erta;
+    if (latency > tooth_latency_max)
+    {
+        tooth_latency_max = latency;
+    }
+}
+
+/*******************************************************************************
+*  FUNCTION NAME: StallPredict
+*  DESCRIPTION: Follow the deceleration trend of normal tooth periods.
+*    A tooth is decelerating when its period is longer than the last one by
+*    more than stall_decel_ratio. Return 1 when stall_decel_teeth consecutive
+*    teeth are decelerating, so that the stall can be declared without
+*    waiting for the stretched acceptance windows to close.
+*******************************************************************************/
+int8_t CRANK::StallPredict(
+    register_a uint24_t tooth_period)
+{
+    if (stall_decel_teeth != 0)
+    {
+        if (tooth_period > last_tooth_period
+                           + muliur(last_tooth_period, stall_decel_ratio))
+        {
+            if (++stall_decel_count >= stall_decel_teeth)
+            {
+                stall_predicted_count++;
+                return 1;
+            }
+        }
+        else
+        {
+            stall_decel_count = 0;
+        }
+    }
+    return 0;
+}
+
 /*******************************************************************************
 *  FUNCTION NAME: Set_TRR
 *  DESCRIPTION: Calculates the tick rate and sets the Tick Rate Register (TRR).
+*    The normalized tooth period and its change are published in
+*    eng_tooth_period and eng_tooth_period_change.
 *******************************************************************************/
 void CRANK::Set_TRR(
     register_a uint24_t tooth_period_norm)
@@ -512,10 +627,12 @@ void CRANK::Set_TRR(
     {
         /* calculate the acceleration */
         tmp = tooth_period_norm - last_last_tooth_period_norm;
+        eng_tooth_period_change = tmp;
         /* dampen the adjustment by 25% */
         tmp = mulir(tmp, 0.75);
     }
     last_last_tooth_period_norm = tooth_period_norm;
+    eng_tooth_period = tooth_period_norm;
 
     eng_trr_norm = (((tooth_period_norm + tmp) / tcr2_ticks_per_tooth) << TRR_FRACTIONAL_BITS); /* integer part of TRR */
     eng_trr_norm += (mach << TRR_FRACTIONAL_BITS) / tcr2_ticks_per_tooth;                       /* fractional part of TRR */
@@ -531,6 +648,393 @@ void CRANK::Set_TRR(
     }
 }
 
+/*******************************************************************************
+*  FUNCTION NAME: CommonTransition_NoReturn
+*  DESCRIPTION: Handle a tooth transition in the states which are common to
+*    both the crank wheel with gap and the crank wheel with an additional
+*    tooth, and end the thread.
+*******************************************************************************/
+_eTPU_fragment CRANK::CommonTransition_NoReturn(void)
+{
+    uint24_t   tooth_period;
+
+    switch (state)
+    {
+    case CRANK_SEEK:
+        /**************************************************************
+        * STATE: T0 - SEEK
+        * DESCRIPTION:
+        *   First transition after INIT was detected.
+        *   Wait for blank_time without detecting transitions.
+        **************************************************************/
+        channel.TDL = TDL_CLEAR;
+        tcr2 = 0;
+        /* set_state */
+        state = CRANK_BLANK_TIME;
+        /* do not detect transitions */
+        channel.IPACA = IPAC_NO_DETECT;
+        /* keep window opened, close window after blank_time */
+        WindowCloseAt_NoReturn(erta + blank_time);
+        break;
+
+    case CRANK_BLANK_TEETH:
+        /**************************************************************
+        * STATE: T2 - BLANK_TEETH
+        * DESCRIPTION:
+        *   Count down blank_teeth without tooth period measurement.
+        **************************************************************/
+        channel.TDL = TDL_CLEAR;
+        tcr2 = 0;
+        /* Count down blank_teeth */
+        if (--blank_teeth <= 0)
+        {
+            /* set_state */
+            state = CRANK_FIRST_TRANS;
+        }
+        break;
+
+    case CRANK_FIRST_TRANS:
+        /**************************************************************
+        * STATE: T3 - FIRST_TRANS
+        * DESCRIPTION:
+        *   First transition after blank_teeth was detected.
+        *   Record transition time.
+        *   Next transition is expected within first_tooth_timeout.
+        **************************************************************/
+        channel.TDL = TDL_CLEAR;
+        tcr2 = 0;
+        /* set_state */
+        state = CRANK_SECOND_TRANS;
+        /* record last_tooth_tcr1_time */
+        last_tooth_tcr1_time = erta;
+        /* keep window opened, close window after first_tooth_timeout */
+        WindowCloseAt_NoReturn(erta + first_tooth_timeout);
+        break;
+
+    case CRANK_COUNTING_TIMEOUT:
+        /**************************************************************
+        * STATE: T8 - COUNTING_TIMEOUT
+        * DESCRIPTION:
+        *   Transition detected within window after a single timeout.
+        *   Recover and continue normal counting.
+        **************************************************************/
+        /* recover from counting timeout */
+        /* set state */
+        state = CRANK_COUNTING;
+        /* continue to normal processing at CRANK_COUNTING */
+
+    case CRANK_COUNTING:
+        /**************************************************************
+        * STATE: T7 - COUNTING
+        * DESCRIPTION:
+        *   Transition detected in normal window.
+        *   Calculate tooth period and record transition time.
+        *   Increment tooth counters.
+        *   Check if the next tooth is the last before gap.
+        *   Adjust TCR2 rate.
+        *   Expect next transition in normal window.
+        **************************************************************/
+        // channel.TDL = TDL_CLEAR; - ONLY CLEAR TDL after the next window is set
+        /* record last_tooth_period and last_tooth_tcr1_time */
+        tooth_period = erta - last_tooth_tcr1_time;
+        /* stall prediction - a steep deceleration trend */
+        if (StallPredict(tooth_period))
+        {
+            channel.TDL = TDL_CLEAR;
+            Stall_NoReturn();
+        }
+        last_tooth_tcr1_time = erta;
+        last_tooth_period = tooth_period;
+        last_tooth_period_norm = tooth_period;
+        /* increment tooth counters */
+        tooth_counter_gap++;
+        tooth_counter_cycle++;
+        /* test if before the gap */
+        if (tooth_counter_gap == teeth_till_gap - 1)
+        {
+            /* there is one more teeth till the gap */
+            state = CRANK_TOOTH_BEFORE_GAP;
+        }
+        /* set TRR */
+        Set_TRR(tooth_period);
+#ifdef ERRATA_2477
+        /* this state is shared by both wheels, but only the gap wheel reads
+           and resets err2477_tcr2_target - the additional-tooth wheel just
+           advances an unused value */
+        err2477_tcr2_target += tcr2_ticks_per_tooth;
+#endif
+        /* log tooth period */
+        ToothArray_Log(tooth_period);
+        /* open and close window using win_ratio_normal */
+        Window_NoReturn(win_ratio_normal, tooth_period);
+        break;
+
+    case CRANK_BLANK_TIME:
+        /**************************************************************
+        * STATE: T1 - BLANK_TIME
+        * DESCRIPTION:
+        *   Transition detection should never happen in this state.
+        *   Set CRANK_ERR_INVALID_TRANS.
+        **************************************************************/
+        channel.TDL = TDL_CLEAR;
+        error |= CRANK_ERR_INVALID_TRANS;
+        break;
+
+    default:
+        channel.TDL = TDL_CLEAR;
+        error |= CRANK_ERR_INTERNAL;
+        break;
+    }
+}
+
+/*******************************************************************************
+*  FUNCTION NAME: CommonTimeout_NoReturn
+*  DESCRIPTION: Handle a timeout in the states which are common to both
+*    the crank wheel with gap and the crank wheel with an additional tooth,
+*    and end the thread.
+*******************************************************************************/
+_eTPU_fragment CRANK::CommonTimeout_NoReturn(void)
+{
+    uint24_t   tooth_period;
+
+    switch (state)
+    {
+    case CRANK_BLANK_TIME:
+        /**************************************************************
+        * STATE: M1 - BLANK_TIME
+        * DESCRIPTION:
+        *   Blank_time after the first transition has passed.
+        *   Start to detect transitions.
+        **************************************************************/
+        tcr2 = 0;
+        if (cc.FM0 == CRANK_FM0_USE_TRANS_RISING)
+        {
+            channel.IPACA = IPAC_RISING;
+        }
+        else
+        {
+            channel.IPACA = IPAC_FALLING;
+        }
+        /* open window immediately, do not close it */
+        erta = tcr1;
+        channel.MRLA = MRL_CLEAR;
+        channel.ERWA = ERW_WRITE_ERT_TO_MATCH;
+        /* set next state */
+        state = CRANK_BLANK_TEETH;
+        if (blank_teeth == 0)
+        {
+            state = CRANK_FIRST_TRANS;
+        }
+        break;
+
+    case CRANK_SECOND_TRANS:      /* first_tooth_timeout */
+    case CRANK_TEST_POSSIBLE_GAP: /* long timeout over a possible gap or win_ratio_normal */
+    case CRANK_VERIFY_GAP:        /* win_ratio_after_gap or win_ratio_normal */
+        /**************************************************************
+        * STATE: M4, M5, M6 - SECOND_TRANS, TEST_POSSIBLE_GAP,
+        *                     VERIFY_GAP
+        * DESCRIPTION:
+        *   Transition not detected in a window, timeout happened
+        *   while gap is not verified.
+        *   Set CRANK_ERR_TIMEOUT.
+        *   Open the acceptance window immediately and do not close it.
+        **************************************************************/
+        /* timeout happened while gap is not verified */
+        tcr2 = 0;
+        error |= CRANK_ERR_TIMEOUT;
+        state = CRANK_FIRST_TRANS;
+        /* open the acceptance window immediately and do not close it */
+        erta = tcr1;
+        channel.MRLA = MRL_CLEAR;
+        channel.MRLB = MRL_CLEAR;
+        channel.ERWA = ERW_WRITE_ERT_TO_MATCH;
+        break;
+
+    case CRANK_COUNTING:          /* win_ratio_normal */
+        /**************************************************************
+        * STATE: M7 - COUNTING
+        * DESCRIPTION:
+        *   Transition not detected in normal window, this is the first
+        *   timeout, there has not been one immediately before.
+        *   Set CRANK_ERR_TIMEOUT.
+        *   If the engine was decelerating (stall prediction), count the
+        *   missing tooth as a decelerating tooth and stall when
+        *   stall_decel_teeth are reached.
+        *   Insert physical tooth, increment tooth counters.
+        *   Expect next transition in window after timeout.
+        **************************************************************/
+        error |= CRANK_ERR_TIMEOUT;
+        if ((stall_decel_teeth != 0) && (stall_decel_count != 0))
+        {
+            /* the missing tooth is a continuation of the deceleration */
+            if (++stall_decel_count >= stall_decel_teeth)
+            {
+                stall_predicted_count++;
+                Stall_NoReturn();
+            }
+        }
+        state = CRANK_COUNTING_TIMEOUT;
+        /* approximate when the missed tooth should have happened */
+        tooth_period = last_tooth_period;
+        erta = last_tooth_tcr1_time + tooth_period;
+        last_tooth_tcr1_time = erta;
+        /* set IPH because one tooth was missing */
+        tpr_str.IPH = 1;
+#ifdef ERRATA_2477
+        /* unused by the additional-tooth wheel, see COUNTING */
+        err2477_tcr2_target += tcr2_ticks_per_tooth;
+#endif
+        /* increment tooth counters */
+        tooth_counter_gap++;
+        tooth_counter_cycle++;
+        /* test if before the gap */
+        if (tooth_counter_gap == teeth_till_gap - 1)
+        {
+            /* there is one more teeth till the gap */
+            state = CRANK_TOOTH_BEFORE_GAP;
+        }
+        /* log tooth period */
+        ToothArray_Log(tooth_period);
+        /* open and close window using win_ratio_after_timeout */
+        Window_NoReturn(win_ratio_after_timeout, tooth_period);
+        break;
+
+    case CRANK_COUNTING_TIMEOUT:  /* win_ratio_after_timeout */
+        /**************************************************************
+        * STATE: M8 - COUNTING_TIMEOUT
+        * DESCRIPTION:
+        *   Transition not detected in window after timeout, this is
+        *   the second timeout, there has been one immediately before.
+        *   Set ENG_POS_SEEK and IRQ, signal output functions and
+        *   restart searching for the gap.
+        **************************************************************/
+        /* restart searching for the gap */
+        Stall_NoReturn();
+        break;
+
+    case CRANK_TOOTH_BEFORE_GAP:  /* win_ratio_normal */
+        /**************************************************************
+        * STATE: M9 - TOOTH_BEFORE_GAP
+        * DESCRIPTION:
+        *   Transition not detected in normal window before gap.
+        *   Set CRANK_ERR_TIMEOUT_BEFORE_GAP.
+        *   Set ENG_POS_SEEK and IRQ, signal output functions and
+        *   restart searching for the gap.
+        **************************************************************/
+        /* set error */
+        error |= CRANK_ERR_TIMEOUT_BEFORE_GAP;
+        /* restart searching for the gap */
+        Stall_NoReturn();
+        break;
+
+    case CRANK_TOOTH_AFTER_GAP:   /* window across gap or win_ratio_normal */
+        /**************************************************************
+        * STATE: M11 - TOOTH_AFTER_GAP
+        * DESCRIPTION:
+        *   Transition not detected in window across gap.
+        *   Set CRANK_ERR_TIMEOUT_AFTER_GAP.
+        *   Set ENG_POS_SEEK and IRQ, signal output functions and
+        *   restart searching for the gap.
+        **************************************************************/
+        /* set error */
+        error |= CRANK_ERR_TIMEOUT_AFTER_GAP;
+        /* restart searching for the gap */
+        Stall_NoReturn();
+        break;
+
+    case CRANK_SEEK:
+    case CRANK_BLANK_TEETH:
+    case CRANK_FIRST_TRANS:
+        /**************************************************************
+        * STATE: M0, M2, M3 - SEEK, BLANK_TEETH, FIRST_TRANS
+        * DESCRIPTION:
+        *   Match detection should never happen in this state.
+        *   Set CRANK_ERR_INVALID_MATCH.
+        **************************************************************/
+        error |= CRANK_ERR_INVALID_MATCH;
+        break;
+
+    default:
+        error |= CRANK_ERR_INTERNAL;
+        break;
+    }
+}
+
+/*******************************************************************************
+*  FUNCTION NAME: CycleEnd_NoReturn
+*  DESCRIPTION: Called on the first tooth after the gap (or after the
+*    additional tooth) once the gap is verified. When the sync-cycle or
+*    engine-cycle is finished:
+*      In ENG_POS_FIRST_HALF_SYNC,
+*        ask CPU to decode the Cam log,
+*        reset TCR2, reset tooth_counter_cycle,
+*        set ENG_POS_PRE_FULL_SYNC and IRQ.
+*      In ENG_POS_PRE_FULL_SYNC, there was no response from CPU,
+*        reset Cam log, reset TCR2, reset tooth_counter_cycle,
+*        set ENG_POS_FIRST_HALF_SYNC and IRQ.
+*      In ENG_POS_FULL_SYNC,
+*        reset Cam log, reset tooth_counter_cycle,
+*        set IRQ (once per cycle in full sync)
+*        increment eng_cycle_tcr2_start by one cycle
+*    Log tooth_period, open and close the next window using win_ratio and
+*    tooth_period, and end the thread.
+*******************************************************************************/
+_eTPU_fragment CRANK::CycleEnd_NoReturn(
+    register_a fract24_t win_ratio,
+    register_d uint24_t tooth_period)
+{
+    switch (eng_pos_state)
+    {
+    case ENG_POS_FIRST_HALF_SYNC:
+        /* if the sync cycle is finished */
+        if (tooth_counter_cycle >= teeth_per_sync)
+        { /* It is time to ask the CPU to decode which half-cycle it was */
+            /* set global eng_pos state and channel interrupt */
+            eng_pos_state = ENG_POS_PRE_FULL_SYNC;
+            channel.CIRC = CIRC_INT_FROM_SERVICED;
+            ToothTcr2Sync_NoReturn();
+        }
+        break;
+    case ENG_POS_PRE_FULL_SYNC:
+        /* if the sync cycle is finished */
+        if (tooth_counter_cycle >= teeth_per_sync)
+        { /* no answer from the CPU has been received during the whole
+             sync cycle */
+             /* set global eng_pos state and channel interrupt */
+            eng_pos_state = ENG_POS_FIRST_HALF_SYNC;
+            channel.CIRC = CIRC_INT_FROM_SERVICED;
+            /* reset Cam log */
+            Link4(link_cam);
+            ToothTcr2Sync_NoReturn();
+        }
+        break;
+    case ENG_POS_FULL_SYNC:
+        /* if the engine cycle is finished */
+        if (tooth_counter_cycle >= teeth_per_cycle)
+        {
+            /* set channel interrupt - once per cycle in full-sync */
+#if defined(__TARGET_ETPU2__) || defined(__ETPU2__)
+            channel.CIRC = CIRC_BOTH_FROM_SERVICED;  /* on eTPU2, set also DMA request */
+#else
+            channel.CIRC = CIRC_INT_FROM_SERVICED;
+#endif
+            /* reset Cam log */
+            Link4(link_cam);
+            /* reset tooth_counter_cycle */
+            tooth_counter_cycle = 1;
+            /* collect diagnostic data */
+            tcr2_error_at_cycle_start = tcr2 - eng_cycle_tcr2_start - tcr2_adjustment;
+            /* increment eng_cycle_tcr2_start by one cycle */
+            eng_cycle_tcr2_start += eng_cycle_tcr2_ticks;
+        }
+        break;
+    }
+    /* log tooth period (after possible tooth_counter_cycle reset) */
+    ToothArray_Log(tooth_period);
+    /* open and close window */
+    Window_NoReturn(win_ratio, tooth_period);
+}
+
 
 /*******************************************************************************
 *  eTPU Function
@@ -585,6 +1089,8 @@ _eTPU_thread CRANK::INIT(_eTPU_matches_disabled)
     eng_pos_state = ENG_POS_SEEK;
     eng_cycle_tcr2_start = eng_cycle_tcr2_ticks;
     state = CRANK_SEEK;
+    tooth_latency_max = 0;
+    link_deferred_idx = 0;
 
     /* Schedule Match A to open window */
     erta = tcr1 + 1; /* the +1 means that the window won't open until the
@@ -608,16 +1114,74 @@ _eTPU_thread CRANK::ANGLE_ADJUST(_eTPU_matches_disabled)
     /* set global eng_pos state */
     eng_pos_state = ENG_POS_FULL_SYNC;
 
-    /* signal other functions that crank has reached full sync */
+    /* signal other functions that crank has reached full sync - the critical
+       links first, the rest is sent from the LINKS_DEFERRED thread */
     Link4(link_1);
     Link4(link_2);
-    Link4(link_3);
-    Link4(link_4);
+    link_deferred_idx = 0;
+    link = chan;
+}
+
+/**************************************************************************
+* THREAD NAME: RESYNC
+* DESCRIPTION: Drop the synchronization and restart it from seeking the gap,
+*              the same way as on a stall. Used by the CPU when the engine
+*              phase is found wrong, e.g. on a CAM phase check error.
+**************************************************************************/
+_eTPU_thread CRANK::RESYNC(_eTPU_matches_disabled)
+{
+    Stall_NoReturn();
+}
+
+/**************************************************************************
+* THREAD NAME: LINKS_DEFERRED
+* DESCRIPTION: Send the non-critical links (link_3, link_4 and the
+*              link_extra sets), deferred from Stall_NoReturn or
+*              ANGLE_ADJUST by a link to self.
+*              At most CRANK_LINKS_DEFERRED_MAX sets are sent by one
+*              service, the rest by the next services, re-activated by
+*              another link to self. This bounds the thread length and
+*              lets the tooth service and the critical channels run
+*              between the bursts of link services.
+**************************************************************************/
+_eTPU_thread CRANK::LINKS_DEFERRED(_eTPU_matches_disabled)
+{
+    uint8_t i;
+
+    channel.LSR = LSR_CLEAR;
+    for (i = CRANK_LINKS_DEFERRED_MAX; i > 0; i--)
+    {
+        if (link_deferred_idx == 0)
+        {
+            Link4(link_3);
+        }
+        else if (link_deferred_idx == 1)
+        {
+            Link4(link_4);
+        }
+        else if (link_deferred_idx < link_extra_count + 2)
+        {
+            Link4(link_extra[link_deferred_idx - 2]);
+        }
+        else
+        {
+            /* all sets sent */
+            return;
+        }
+        link_deferred_idx++;
+    }
+    /* continue with the next sets in the next service */
+    if (link_deferred_idx < link_extra_count + 2)
+    {
+        link = chan;
+    }
 }
 
 /**************************************************************************
 * THREAD NAME: CRANK_WITH_GAP
 * DESCRIPTION: A transition or a timeout, handling a crank wheel with gap.
+*              States which are not specific to the gap are handled by
+*              CommonTransition_NoReturn and CommonTimeout_NoReturn.
 **************************************************************************/
 _eTPU_thread CRANK::CRANK_WITH_GAP(_eTPU_matches_enabled)
 {
@@ -628,59 +1192,9 @@ _eTPU_thread CRANK::CRANK_WITH_GAP(_eTPU_matches_enabled)
     if (cc.TDLA == 1)
     {
         /* A tooth transition detected */
+        ToothLatency_Log();
         switch (state)
         {
-        case CRANK_SEEK:
-            /**************************************************************
-            * STATE: T0 - SEEK
-            * DESCRIPTION:
-            *   First transition after INIT was detected.
-            *   Wait for blank_time without detecting transitions.
-            **************************************************************/
-            channel.TDL = TDL_CLEAR;
-            tcr2 = 0;
-            /* set_state */
-            state = CRANK_BLANK_TIME;
-            /* do not detect transitions */
-            channel.IPACA = IPAC_NO_DETECT;
-            /* keep window opened, close window after blank_time */
-            WindowCloseAt_NoReturn(erta + blank_time);
-            break;
-
-        case CRANK_BLANK_TEETH:
-            /**************************************************************
-            * STATE: T2 - BLANK_TEETH
-            * DESCRIPTION:
-            *   Count down blank_teeth without tooth period measurement.
-            **************************************************************/
-            channel.TDL = TDL_CLEAR;
-            tcr2 = 0;
-            /* Count down blank_teeth */
-            if (--blank_teeth <= 0)
-            {
-                /* set_state */
-                state = CRANK_FIRST_TRANS;
-            }
-            break;
-
-        case CRANK_FIRST_TRANS:
-            /**************************************************************
-            * STATE: T3 - FIRST_TRANS
-            * DESCRIPTION:
-            *   First transition after blank_teeth was detected.
-            *   Record transition time.
-            *   Next transition is expected within first_tooth_timeout.
-            **************************************************************/
-            channel.TDL = TDL_CLEAR;
-            tcr2 = 0;
-            /* set_state */
-            state = CRANK_SECOND_TRANS;
-            /* record last_tooth_tcr1_time */
-            last_tooth_tcr1_time = erta;
-            /* keep window opened, close window after first_tooth_timeout */
-            WindowCloseAt_NoReturn(erta + first_tooth_timeout);
-            break;
-
         case CRANK_SECOND_TRANS:
             /**************************************************************
             * STATE: T4 - SECOND_TRANS
@@ -804,55 +1318,6 @@ _eTPU_thread CRANK::CRANK_WITH_GAP(_eTPU_matches_enabled)
             }
             break;
 
-        case CRANK_COUNTING_TIMEOUT:
-            /**************************************************************
-            * STATE: T8 - COUNTING_TIMEOUT
-            * DESCRIPTION:
-            *   Transition detected within window after a single timeout.
-            *   Recover and continue normal counting.
-            **************************************************************/
-            /* recover from counting timeout */
-            /* set state */
-            state = CRANK_COUNTING;
-            /* continue to normal processing at CRANK_COUNTING */
-
-        case CRANK_COUNTING:
-            /**************************************************************
-            * STATE: T7 - COUNTING
-            * DESCRIPTION:
-            *   Transition detected in normal window.
-            *   Calculate tooth period and record transition time.
-            *   Increment tooth counters.
-            *   Check if the next tooth is the last before gap.
-            *   Adjust TCR2 rate.
-            *   Expect next transition in normal window.
-            **************************************************************/
-            // channel.TDL = TDL_CLEAR; - ONLY CLEAR TDL after the next window is set
-            /* record last_tooth_period and last_tooth_tcr1_time */
-            tooth_period = erta - last_tooth_tcr1_time;
-            last_tooth_tcr1_time = erta;
-            last_tooth_period = tooth_period;
-            last_tooth_period_norm = tooth_period;
-            /* increment tooth counters */
-            tooth_counter_gap++;
-            tooth_counter_cycle++;
-            /* test if before the gap */
-            if (tooth_counter_gap == teeth_till_gap - 1)
-            {
-                /* there is one more teeth till the gap */
-                state = CRANK_TOOTH_BEFORE_GAP;
-            }
-            /* set TRR */
-            Set_TRR(tooth_period);
-#ifdef ERRATA_2477
-            err2477_tcr2_target += tcr2_ticks_per_tooth;
-#endif
-            /* log tooth period */
-            ToothArray_Log(tooth_period);
-            /* open and close window using win_ratio_normal */
-            Window_NoReturn(win_ratio_normal, tooth_period);
-            break;
-
         case CRANK_TOOTH_BEFORE_GAP:
             /**************************************************************
             * STATE: T9 - TOOTH_BEFORE_GAP
@@ -906,19 +1371,9 @@ _eTPU_thread CRANK::CRANK_WITH_GAP(_eTPU_matches_enabled)
             *   Calculate tooth period and record transition time.
             *   Verify the gap (AB of ABA test).
             *   If gap verified, adjust TCR2 rate and tooth counters,
-            *     sync-cycle or engine-cycle is finished:
-            *     In ENG_POS_FIRST_HALF_SYNC,
-            *       ask CPU to decode the Cam log,
-            *       reset TCR2, reset tooth_counter_cycle,
-            *       set ENG_POS_PRE_FULL_SYNC and IRQ.
-            *     In ENG_POS_PRE_FULL_SYNC, there was no response from CPU,
-            *       reset Cam log, reset TCR2, reset tooth_counter_cycle,
-            *       set ENG_POS_FIRST_HALF_SYNC and IRQ.
-            *     In ENG_POS_FULL_SYNC,
-            *       reset Cam log, reset tooth_counter_cycle,
-            *       set IRQ (once per cycle in full sync)
-            *       increment eng_cycle_tcr2_start by one cycle
-            *     Expect next transition in window after gap.
+            *     handle the end of sync-cycle or engine-cycle
+            *     (see CycleEnd_NoReturn),
+            *     expect next transition in window after gap.
             *   Else, gap not verified, set CRANK_ERR_TOOTH_IN_GAP,
             *     set ENG_POS_SEEK and IRQ, signal output functions and
             *     restart searching for the gap
@@ -952,57 +1407,9 @@ _eTPU_thread CRANK::CRANK_WITH_GAP(_eTPU_matches_enabled)
                 err2477_tcr2_target +=
                     (teeth_in_gap + 1U) * tcr2_ticks_per_tooth;
 #endif
-                /* when the sync-cycle or engine-cycle is finished */
-                switch (eng_pos_state)
-                {
-                case ENG_POS_FIRST_HALF_SYNC:
-                    /* if the sync cycle is finished */
-                    if (tooth_counter_cycle >= teeth_per_sync)
-                    { /* It is time to ask the CPU to decode which half-cycle it was */
-                        /* set global eng_pos state and channel interrupt */
-                        eng_pos_state = ENG_POS_PRE_FULL_SYNC;
-                        channel.CIRC = CIRC_INT_FROM_SERVICED;
-                        ToothTcr2Sync_NoReturn();
-                    }
-                    break;
-                case ENG_POS_PRE_FULL_SYNC:
-                    /* if the sync cycle is finished */
-                    if (tooth_counter_cycle >= teeth_per_sync)
-                    { /* no answer from the CPU has been received during the whole
-                         sync cycle */
-                         /* set global eng_pos state and channel interrupt */
-                        eng_pos_state = ENG_POS_FIRST_HALF_SYNC;
-                        channel.CIRC = CIRC_INT_FROM_SERVICED;
-                        /* reset Cam log */
-                        Link4(link_cam);
-                        ToothTcr2Sync_NoReturn();
-                    }
-                    break;
-                case ENG_POS_FULL_SYNC:
-                    /* if the engine cycle is finished */
-                    if (tooth_counter_cycle >= teeth_per_cycle)
-                    {
-                        /* set channel interrupt - once per cycle in full-sync */
-#if defined(__TARGET_ETPU2__) || defined(__ETPU2__)
-                        channel.CIRC = CIRC_BOTH_FROM_SERVICED;  /* on eTPU2, set also DMA request */
-#else
-                        channel.CIRC = CIRC_INT_FROM_SERVICED;
-#endif
-                        /* reset Cam log */
-                        Link4(link_cam);
-                        /* reset tooth_counter_cycle */
-                        tooth_counter_cycle = 1;
-                        /* collect diagnostic data */
-                        tcr2_error_at_cycle_start = tcr2 - eng_cycle_tcr2_start - tcr2_adjustment;
-                        /* increment eng_cycle_tcr2_start by one cycle */
-                        eng_cycle_tcr2_start += eng_cycle_tcr2_ticks;
-                    }
-                    break;
-                }
-                /* log tooth period (after possible tooth_counter_cycle reset) */
-                ToothArray_Log(last_tooth_period_norm);
-                /* open and close window using win_ratio_after_gap */
-                Window_NoReturn(win_ratio_after_gap,
+                /* handle the end of sync-cycle or engine-cycle,
+                   open and close window using win_ratio_after_gap */
+                CycleEnd_NoReturn(win_ratio_after_gap,
                     last_tooth_period_norm);
             }
             else
@@ -1018,10 +1425,9 @@ _eTPU_thread CRANK::CRANK_WITH_GAP(_eTPU_matches_enabled)
             }
             break;
 
-        case CRANK_BLANK_TIME:
         case CRANK_TOOTH_BEFORE_GAP_NOT_HRM:
             /**************************************************************
-            * STATE: T1, T10 - BLANK_TIME, TOOTH_BEFORE_GAP_NOT_HRM
+            * STATE: T10 - TOOTH_BEFORE_GAP_NOT_HRM
             * DESCRIPTION:
             *   Transition detection should never happen in this state.
             *   Set CRANK_ERR_INVALID_TRANS.
@@ -1031,8 +1437,8 @@ _eTPU_thread CRANK::CRANK_WITH_GAP(_eTPU_matches_enabled)
             break;
 
         default:
-            channel.TDL = TDL_CLEAR;
-            error |= CRANK_ERR_INTERNAL;
+            /* states common with CRANK_WITH_ADDITIONAL_TOOTH */
+            CommonTransition_NoReturn();
             break;
         }
     }
@@ -1042,121 +1448,6 @@ _eTPU_thread CRANK::CRANK_WITH_GAP(_eTPU_matches_enabled)
         channel.MRLB = MRL_CLEAR;
         switch (state)
         {
-        case CRANK_BLANK_TIME:
-            /**************************************************************
-            * STATE: M1 - BLANK_TIME
-            * DESCRIPTION:
-            *   Blank_time after the first transition has passed.
-            *   Start to detect transitions.
-            **************************************************************/
-            tcr2 = 0;
-            if (cc.FM0 == CRANK_FM0_USE_TRANS_RISING)
-            {
-                channel.IPACA = IPAC_RISING;
-            }
-            else
-            {
-                channel.IPACA = IPAC_FALLING;
-            }
-            /* open window immediately, do not close it */
-            erta = tcr1;
-            channel.MRLA = MRL_CLEAR;
-            channel.ERWA = ERW_WRITE_ERT_TO_MATCH;
-            /* set next state */
-            state = CRANK_BLANK_TEETH;
-            if (blank_teeth == 0)
-            {
-                state = CRANK_FIRST_TRANS;
-            }
-            break;
-
-        case CRANK_SECOND_TRANS:      /* first_tooth_timeout */
-        case CRANK_TEST_POSSIBLE_GAP: /* long timeout over a possible gap */
-        case CRANK_VERIFY_GAP:        /* win_ratio_after_gap */
-            /**************************************************************
-            * STATE: M4, M5, M6 - SECOND_TRANS, TEST_POSSIBLE_GAP,
-            *                     VERIFY_GAP
-            * DESCRIPTION:
-            *   Transition not detected in a window, timeout happened
-            *   while gap is not verified.
-            *   Set CRANK_ERR_TIMEOUT.
-            *   Open the acceptance window immediately and do not close it.
-            **************************************************************/
-            /* timeout happened while gap is not verified */
-            tcr2 = 0;
-            error |= CRANK_ERR_TIMEOUT;
-            state = CRANK_FIRST_TRANS;
-            /* open the acceptance window immediately and do not close it */
-            erta = tcr1;
-            channel.MRLA = MRL_CLEAR;
-            channel.MRLB = MRL_CLEAR;
-            channel.ERWA = ERW_WRITE_ERT_TO_MATCH;
-            break;
-
-        case CRANK_COUNTING:          /* win_ratio_normal */
-            /**************************************************************
-            * STATE: M7 - COUNTING
-            * DESCRIPTION:
-            *   Transition not detected in normal window, this is the first
-            *   timeout, there has not been one immediately before.
-            *   Set CRANK_ERR_TIMEOUT.
-            *   Insert physical tooth, increment tooth counters.
-            *   Expect next transition in window after timeout.
-            **************************************************************/
-            error |= CRANK_ERR_TIMEOUT;
-            state = CRANK_COUNTING_TIMEOUT;
-            /* approximate when the missed tooth should have happened */
-            tooth_period = last_tooth_period;
-            erta = last_tooth_tcr1_time + tooth_period;
-            last_tooth_tcr1_time = erta;
-            /* set IPH because one tooth was missing */
-            tpr_str.IPH = 1;
-#ifdef ERRATA_2477
-            err2477_tcr2_target += tcr2_ticks_per_tooth;
-#endif
-            /* increment tooth counters */
-            tooth_counter_gap++;
-            tooth_counter_cycle++;
-            /* test if before the gap */
-            if (tooth_counter_gap == teeth_till_gap - 1)
-            {
-                /* there is one more teeth till the gap */
-                state = CRANK_TOOTH_BEFORE_GAP;
-            }
-            /* log tooth period */
-            ToothArray_Log(tooth_period);
-            /* open and close window using win_ratio_after_timeout */
-            Window_NoReturn(win_ratio_after_timeout, tooth_period);
-            break;
-
-        case CRANK_COUNTING_TIMEOUT:  /* win_ratio_after_timeout */
-            /**************************************************************
-            * STATE: M8 - COUNTING_TIMEOUT
-            * DESCRIPTION:
-            *   Transition not detected in window after timeout, this is
-            *   the second timeout, there has been one immediately before.
-            *   Set ENG_POS_SEEK and IRQ, signal output functions and
-            *   restart searching for the gap.
-            **************************************************************/
-            /* restart searching for the gap */
-            Stall_NoReturn();
-            break;
-
-        case CRANK_TOOTH_BEFORE_GAP:  /* win_ratio_normal */
-            /**************************************************************
-            * STATE: M9 - TOOTH_BEFORE_GAP
-            * DESCRIPTION:
-            *   Transition not detected in normal window before gap.
-            *   Set CRANK_ERR_TIMEOUT_BEFORE_GAP.
-            *   Set ENG_POS_SEEK and IRQ, signal output functions and
-            *   restart searching for the gap.
-            **************************************************************/
-            /* set error */
-            error |= CRANK_ERR_TIMEOUT_BEFORE_GAP;
-            /* restart searching for the gap */
-            Stall_NoReturn();
-            break;
-
         case CRANK_TOOTH_BEFORE_GAP_NOT_HRM:
             /**************************************************************
             * STATE: M10 - TOOTH_BEFORE_GAP_NOT_HRM
@@ -1177,35 +1468,9 @@ _eTPU_thread CRANK::CRANK_WITH_GAP(_eTPU_matches_enabled)
             WindowAcrossGap_NoReturn(last_tooth_period);
             break;
 
-        case CRANK_TOOTH_AFTER_GAP:   /* long timeout over a possible gap */
-            /**************************************************************
-            * STATE: M11 - TOOTH_AFTER_GAP
-            * DESCRIPTION:
-            *   Transition not detected in window across gap.
-            *   Set CRANK_ERR_TIMEOUT_AFTER_GAP.
-            *   Set ENG_POS_SEEK and IRQ, signal output functions and
-            *   restart searching for the gap.
-            **************************************************************/
-            /* set error */
-            error |= CRANK_ERR_TIMEOUT_AFTER_GAP;
-            /* restart searching for the gap */
-            Stall_NoReturn();
-            break;
-
-        case CRANK_SEEK:
-        case CRANK_BLANK_TEETH:
-        case CRANK_FIRST_TRANS:
-            /**************************************************************
-            * STATE: M0, M2, M3 - SEEK, BLANK_TEETH, FIRST_TRANS
-            * DESCRIPTION:
-            *   Match detection should never happen in this state.
-            *   Set CRANK_ERR_INVALID_MATCH.
-            **************************************************************/
-            error |= CRANK_ERR_INVALID_MATCH;
-            break;
-
         default:
-            error |= CRANK_ERR_INTERNAL;
+            /* states common with CRANK_WITH_ADDITIONAL_TOOTH */
+            CommonTimeout_NoReturn();
             break;
         }
     }
@@ -1215,6 +1480,9 @@ _eTPU_thread CRANK::CRANK_WITH_GAP(_eTPU_matches_enabled)
 * THREAD NAME: CRANK_WITH_ADDITIONAL_TOOTH
 * DESCRIPTION: A transition or a timeout, handling a crank wheel with an
 *              additional tooth.
+*              States which are not specific to the additional tooth are
+*              handled by CommonTransition_NoReturn and
+*              CommonTimeout_NoReturn.
 **************************************************************************/
 _eTPU_thread CRANK::CRANK_WITH_ADDITIONAL_TOOTH(_eTPU_matches_enabled)
 {
@@ -1224,59 +1492,9 @@ _eTPU_thread CRANK::CRANK_WITH_ADDITIONAL_TOOTH(_eTPU_matches_enabled)
     if (cc.TDLA == 1)
     {
         /* A tooth transition detected */
+        ToothLatency_Log();
         switch (state)
         {
-        case CRANK_SEEK:
-            /**************************************************************
-            * STATE: T0 - SEEK
-            * DESCRIPTION:
-            *   First transition after INIT was detected.
-            *   Wait for blank_time without detecting transitions.
-            **************************************************************/
-            channel.TDL = TDL_CLEAR;
-            tcr2 = 0;
-            /* set_state */
-            state = CRANK_BLANK_TIME;
-            /* do not detect transitions */
-            channel.IPACA = IPAC_NO_DETECT;
-            /* keep window opened, close window after blank_time */
-            WindowCloseAt_NoReturn(erta + blank_time);
-            break;
-
-        case CRANK_BLANK_TEETH:
-            /**************************************************************
-            * STATE: T2 - BLANK_TEETH
-            * DESCRIPTION:
-            *   Downcount blank_teeth without tooth period measurement.
-            **************************************************************/
-            channel.TDL = TDL_CLEAR;
-            tcr2 = 0;
-            /* downcount blank_teeth */
-            if (--blank_teeth <= 0)
-            {
-                /* set_state */
-                state = CRANK_FIRST_TRANS;
-            }
-            break;
-
-        case CRANK_FIRST_TRANS:
-            /**************************************************************
-            * STATE: T3 - FIRST_TRANS
-            * DESCRIPTION:
-            *   First transition after blank_teeth was detected.
-            *   Record transition time.
-            *   Next transition is expected within first_tooth_timeout.
-            **************************************************************/
-            channel.TDL = TDL_CLEAR;
-            tcr2 = 0;
-            /* set_state */
-            state = CRANK_SECOND_TRANS;
-            /* record last_tooth_tcr1_time */
-            last_tooth_tcr1_time = erta;
-            /* keep window opened, close window after first_tooth_timeout */
-            WindowCloseAt_NoReturn(erta + first_tooth_timeout);
-            break;
-
         case CRANK_SECOND_TRANS:
             /**************************************************************
             * STATE: T4A - SECOND_TRANS
@@ -1397,52 +1615,6 @@ _eTPU_thread CRANK::CRANK_WITH_ADDITIONAL_TOOTH(_eTPU_matches_enabled)
             }
             break;
 
-        case CRANK_COUNTING_TIMEOUT:
-            /**************************************************************
-            * STATE: T8 - COUNTING_TIMEOUT
-            * DESCRIPTION:
-            *   Transition detected within window after a single timeout.
-            *   Recover and continue normal counting.
-            **************************************************************/
-            /* recover from counting timeout */
-            /* set state */
-            state = CRANK_COUNTING;
-            /* continue to normal processing at CRANK_COUNTING */
-
-        case CRANK_COUNTING:
-            /**************************************************************
-            * STATE: T7 - COUNTING
-            * DESCRIPTION:
-            *   Transition detected in normal window.
-            *   Calculate tooth period and record transition time.
-            *   Increment tooth counters.
-            *   Check if the next tooth is the last before gap.
-            *   Adjust TCR2 rate.
-            *   Expect next transition in normal window.
-            **************************************************************/
-            // channel.TDL = TDL_CLEAR; - ONLY CLEAR TDL after the next window is set
-            /* record last_tooth_period and last_tooth_tcr1_time */
-            tooth_period = erta - last_tooth_tcr1_time;
-            last_tooth_tcr1_time = erta;
-            last_tooth_period = tooth_period;
-            last_tooth_period_norm = tooth_period;
-            /* increment tooth counters */
-            tooth_counter_gap++;
-            tooth_counter_cycle++;
-            /* test if before the gap */
-            if (tooth_counter_gap == teeth_till_gap - 1)
-            {
-                /* there is one more teeth till the gap */
-                state = CRANK_TOOTH_BEFORE_GAP;
-            }
-            /* set TRR */
-            Set_TRR(tooth_period);
-            /* log tooth period */
-            ToothArray_Log(tooth_period);
-            /* open and close window using win_ratio_normal */
-            Window_NoReturn(win_ratio_normal, tooth_period);
-            break;
-
         case CRANK_TOOTH_BEFORE_GAP:
             /**************************************************************
             * STATE: T9A - TOOTH_BEFORE_GAP
@@ -1529,19 +1701,9 @@ _eTPU_thread CRANK::CRANK_WITH_ADDITIONAL_TOOTH(_eTPU_matches_enabled)
             *   Calculate tooth period and record transition time.
             *   Verify the additional tooth (BA of ABA test).
             *   If additional tooth verified, adjust TCR2 rate and tooth
-            *     counters, sync-cycle or engine-cycle is finished:
-            *     In ENG_POS_FIRST_HALF_SYNC,
-            *       ask CPU to decode the Cam log,
-            *       reset TCR2, reset tooth_counter_cycle,
-            *       set ENG_POS_PRE_FULL_SYNC and IRQ.
-            *     In ENG_POS_PRE_FULL_SYNC, there was no response from CPU,
-            *       reset Cam log, reset TCR2, reset tooth_counter_cycle,
-            *       set ENG_POS_FIRST_HALF_SYNC and IRQ.
-            *     In ENG_POS_FULL_SYNC,
-            *       reset Cam log, reset tooth_counter_cycle,
-            *       set IRQ (once per cycle in full sync)
-            *       increment eng_cycle_tcr2_start by one cycle
-            *     Expect next transition in normal window.
+            *     counters, handle the end of sync-cycle or engine-cycle
+            *     (see CycleEnd_NoReturn),
+            *     expect next transition in normal window.
             *   Else, additional tooth not verified, set CRANK_ERR_TOOTH_IN_GAP,
             *     set ENG_POS_SEEK and IRQ, signal output functions and
             *     restart searching for the gap
@@ -1567,57 +1729,9 @@ _eTPU_thread CRANK::CRANK_WITH_ADDITIONAL_TOOTH(_eTPU_matches_enabled)
                 /* set tooth counters - first tooth after gap */
                 tooth_counter_gap = 1;
                 tooth_counter_cycle++;
-                /* log tooth period */
-                ToothArray_Log(tooth_period);
-                /* when the sync-cycle or engine-cycle is finished */
-                switch (eng_pos_state)
-                {
-                case ENG_POS_FIRST_HALF_SYNC:
-                    /* if the sync cycle is finished */
-                    if (tooth_counter_cycle >= teeth_per_sync)
-                    { /* It is time to ask the CPU to decode which half-cycle it was */
-                        /* set global eng_pos state and channel interrupt */
-                        eng_pos_state = ENG_POS_PRE_FULL_SYNC;
-                        channel.CIRC = CIRC_INT_FROM_SERVICED;
-                        ToothTcr2Sync_NoReturn();
-                    }
-                    break;
-                case ENG_POS_PRE_FULL_SYNC:
-                    /* if the sync cycle is finished */
-                    if (tooth_counter_cycle >= teeth_per_sync)
-                    { /* no answer from the CPU has been received during the whole
-                         sync cycle */
-                         /* set global eng_pos state and channel interrupt */
-                        eng_pos_state = ENG_POS_FIRST_HALF_SYNC;
-                        channel.CIRC = CIRC_INT_FROM_SERVICED;
-                        /* reset Cam log */
-                        Link4(link_cam);
-                        ToothTcr2Sync_NoReturn();
-                    }
-                    break;
-                case ENG_POS_FULL_SYNC:
-                    /* if the engine cycle is finished */
-                    if (tooth_counter_cycle >= teeth_per_cycle)
-                    {
-                        /* set channel interrupt - once per cycle in full-sync */
-#if defined(__TARGET_ETPU2__)
-                        channel.CIRC = CIRC_BOTH_FROM_SERVICED;  /* on eTPU2, set also DMA request */
-#else
-                        channel.CIRC = CIRC_INT_FROM_SERVICED;
-#endif
-                        /* reset Cam log */
-                        Link4(link_cam);
-                        /* reset tooth_counter_cycle */
-                        tooth_counter_cycle = 1;
-                        /* collect diagnostic data */
-                        tcr2_error_at_cycle_start = tcr2 - eng_cycle_tcr2_start - tcr2_adjustment;
-                        /* increment eng_cycle_tcr2_start by one cycle */
-                        eng_cycle_tcr2_start += eng_cycle_tcr2_ticks;
-                    }
-                    break;
-                }
-                /* open and close window using win_ratio_normal */
-                Window_NoReturn(win_ratio_normal, tooth_period);
+                /* handle the end of sync-cycle or engine-cycle,
+                   open and close window using win_ratio_normal */
+                CycleEnd_NoReturn(win_ratio_normal, tooth_period);
             }
             else
             { /* additional tooth not verified */
@@ -1634,20 +1748,9 @@ _eTPU_thread CRANK::CRANK_WITH_ADDITIONAL_TOOTH(_eTPU_matches_enabled)
             }
             break;
 
-        case CRANK_BLANK_TIME:
-            /**************************************************************
-            * STATE: T1 - BLANK_TIME
-            * DESCRIPTION:
-            *   Transition detection should never happen in this state.
-            *   Set CRANK_ERR_INVALID_TRANS.
-            **************************************************************/
-            channel.TDL = TDL_CLEAR;
-            error |= CRANK_ERR_INVALID_TRANS;
-            break;
-
         default:
-            channel.TDL = TDL_CLEAR;
-            error |= CRANK_ERR_INTERNAL;
+            /* states common with CRANK_WITH_GAP */
+            CommonTransition_NoReturn();
             break;
         }
     }
@@ -1657,158 +1760,24 @@ _eTPU_thread CRANK::CRANK_WITH_ADDITIONAL_TOOTH(_eTPU_matches_enabled)
         channel.MRLB = MRL_CLEAR;
         switch (state)
         {
-        case CRANK_BLANK_TIME:
-            /**************************************************************
-            * STATE: M1 - BLANK_TIME
-            * DESCRIPTION:
-            *   Blank_time after the first transition has passed.
-            *   Start to detect transitions.
-            **************************************************************/
-            tcr2 = 0;
-            if (cc.FM0 == CRANK_FM0_USE_TRANS_RISING)
-            {
-                channel.IPACA = IPAC_RISING;
-            }
-            else
-            {
-                channel.IPACA = IPAC_FALLING;
-            }
-            /* open window immediately, do not close it */
-            erta = tcr1;
-            channel.MRLA = MRL_CLEAR;
-            channel.ERWA = ERW_WRITE_ERT_TO_MATCH;
-            /* set next state */
-            state = CRANK_BLANK_TEETH;
-            if (blank_teeth == 0)
-            {
-                state = CRANK_FIRST_TRANS;
-            }
-            break;
-
-        case CRANK_SECOND_TRANS:      /* first_tooth_timeout */
-        case CRANK_TEST_POSSIBLE_GAP: /* win_ratio_normal */
-        case CRANK_VERIFY_GAP:        /* win_ratio_normal */
-            /**************************************************************
-            * STATE: M4, M5, M6 - SECOND_TRANS, TEST_POSSIBLE_GAP,
-            *                     VERIFY_GAP
-            * DESCRIPTION:
-            *   Transition not detected in a window, timeout happened
-            *   while gap is not verified.
-            *   Set CRANK_ERR_TIMEOUT.
-            *   Open the acceptance window immediately and do not close it.
-            **************************************************************/
-            /* timeout happened while gap is not verified */
-            tcr2 = 0;
-            error |= CRANK_ERR_TIMEOUT;
-            state = CRANK_FIRST_TRANS;
-            /* open the acceptance window immediately and do not close it */
-            erta = tcr1;
-            channel.MRLA = MRL_CLEAR;
-            channel.MRLB = MRL_CLEAR;
-            channel.ERWA = ERW_WRITE_ERT_TO_MATCH;
-            break;
-
-        case CRANK_COUNTING:          /* win_ratio_normal */
-            /**************************************************************
-            * STATE: M7 - COUNTING
-            * DESCRIPTION:
-            *   Transition not detected in normal window, this is the first
-            *   timeout, there has not been one immediately before.
-            *   Set CRANK_ERR_TIMEOUT.
-            *   Insert physical tooth, increment tooth counters.
-            *   Expect next transition in window after timeout.
-            **************************************************************/
-            error |= CRANK_ERR_TIMEOUT;
-            state = CRANK_COUNTING_TIMEOUT;
-            /* approximate when the missed tooth should have happened */
-            tooth_period = last_tooth_period;
-            erta = last_tooth_tcr1_time + tooth_period;
-            last_tooth_tcr1_time = erta;
-            /* set IPH because one tooth was missing */
-            tpr_str.IPH = 1;
-            /* increment tooth counters */
-            tooth_counter_gap++;
-            tooth_counter_cycle++;
-            /* test if before the gap */
-            if (tooth_counter_gap == teeth_till_gap - 1)
-            {
-                /* there is one more teeth till the gap */
-                state = CRANK_TOOTH_BEFORE_GAP;
-            }
-            /* log tooth period */
-            ToothArray_Log(tooth_period);
-            /* open and close window using win_ratio_after_timeout */
-            Window_NoReturn(win_ratio_after_timeout, tooth_period);
-            break;
-
-        case CRANK_COUNTING_TIMEOUT:  /* win_ratio_after_timeout */
-            /**************************************************************
-            * STATE: M8 - COUNTING_TIMEOUT
-            * DESCRIPTION:
-            *   Transition not detected in window after timeout, this is
-            *   the second timeout, there has been one immediately before.
-            *   Set ENG_POS_SEEK and IRQ, signal output functions and
-            *   restart searching for the gap.
-            **************************************************************/
-            /* restart searching for the gap */
-            Stall_NoReturn();
-            break;
-
-        case CRANK_TOOTH_BEFORE_GAP:  /* win_ratio_normal */
-            /**************************************************************
-            * STATE: M9 - TOOTH_BEFORE_GAP
-            * DESCRIPTION:
-            *   Transition not detected in normal window before gap.
-            *   Set CRANK_ERR_TIMEOUT_BEFORE_GAP.
-            *   Set ENG_POS_SEEK and IRQ, signal output functions and
-            *   restart searching for the gap.
-            **************************************************************/
-            /* set error */
-            error |= CRANK_ERR_TIMEOUT_BEFORE_GAP;
-            /* restart searching for the gap */
-            Stall_NoReturn();
-            break;
-
         case CRANK_ADDITIONAL_TOOTH:   /* win_ratio_normal */
             /**************************************************************
             * STATE: M10A - CRANK_ADDITIONAL_TOOTH
             * DESCRIPTION:
-            **************************************************************/
-            /* set error */
-            error |= CRANK_ERR_ADD_TOOTH_NOT_FOUND;
-            /* restart searching for the gap */
-            Stall_NoReturn();
-            break;
-
-        case CRANK_TOOTH_AFTER_GAP:   /* win_ratio_normal */
-            /**************************************************************
-            * STATE: M11 - TOOTH_AFTER_GAP
-            * DESCRIPTION:
-            *   Transition not detected in window across gap.
-            *   Set CRANK_ERR_TIMEOUT_AFTER_GAP.
+            *   Additional tooth not detected in window.
+            *   Set CRANK_ERR_ADD_TOOTH_NOT_FOUND.
             *   Set ENG_POS_SEEK and IRQ, signal output functions and
             *   restart searching for the gap.
             **************************************************************/
             /* set error */
-            error |= CRANK_ERR_TIMEOUT_AFTER_GAP;
+            error |= CRANK_ERR_ADD_TOOTH_NOT_FOUND;
             /* restart searching for the gap */
             Stall_NoReturn();
             break;
 
-        case CRANK_SEEK:
-        case CRANK_BLANK_TEETH:
-        case CRANK_FIRST_TRANS:
-            /**************************************************************
-            * STATE: M0, M2, M3 - SEEK, BLANK_TEETH, FIRST_TRANS
-            * DESCRIPTION:
-            *   Match detection should never happen in this state.
-            *   Set CRANK_ERR_INVALID_MATCH.
-            **************************************************************/
-            error |= CRANK_ERR_INVALID_MATCH;
-            break;
-
         default:
-            error |= CRANK_ERR_INTERNAL;
+            /* states common with CRANK_WITH_GAP */
+            CommonTimeout_NoReturn();
             break;
         }
     }
@@ -1896,13 +1865,19 @@ DEFINE_ENTRY_TABLE(CRANK, CRANK, alternate, inputpin, autocfsr)
     ETPU_VECTOR1(0,     x, 1, 1,  0, 1, 1, CRANK_TOOTH_TCR2_SYNC_ADD),
     ETPU_VECTOR1(0,     x, 1, 1,  1, 1, 1, CRANK_TOOTH_TCR2_SYNC_ADD),
 
+    //           HSR    LSR M1 M2 PIN F0 F1 vector
+    ETPU_VECTOR1(2,     x,  x, x, 0,  0, x, RESYNC),
+    ETPU_VECTOR1(2,     x,  x, x, 0,  1, x, RESYNC),
+    ETPU_VECTOR1(2,     x,  x, x, 1,  0, x, RESYNC),
+    ETPU_VECTOR1(2,     x,  x, x, 1,  1, x, RESYNC),
+
     // unused/invalid entries
-    ETPU_VECTOR2(2,3,   x, x, x,  0, 0, x, _Error_handler_unexpected_thread),
-    ETPU_VECTOR2(2,3,   x, x, x,  0, 1, x, _Error_handler_unexpected_thread),
-    ETPU_VECTOR2(2,3,   x, x, x,  1, 0, x, _Error_handler_unexpected_thread),
-    ETPU_VECTOR2(2,3,   x, x, x,  1, 1, x, _Error_handler_unexpected_thread),
-    ETPU_VECTOR1(0,     1, 0, 0,  0, x, x, _Error_handler_unexpected_thread),
-    ETPU_VECTOR1(0,     1, 0, 0,  1, x, x, _Error_handler_unexpected_thread),
+    ETPU_VECTOR1(3,     x,  x, x, 0,  0, x, _Error_handler_unexpected_thread),
+    ETPU_VECTOR1(3,     x,  x, x, 0,  1, x, _Error_handler_unexpected_thread),
+    ETPU_VECTOR1(3,     x,  x, x, 1,  0, x, _Error_handler_unexpected_thread),
+    ETPU_VECTOR1(3,     x,  x, x, 1,  1, x, _Error_handler_unexpected_thread),
+    ETPU_VECTOR1(0,     1, 0, 0,  0, x, x, LINKS_DEFERRED),
+    ETPU_VECTOR1(0,     1, 0, 0,  1, x, x, LINKS_DEFERRED),
     ETPU_VECTOR1(0,     x, 1, 0,  0, 0, 0, _Error_handler_unexpected_thread),
     ETPU_VECTOR1(0,     x, 1, 0,  0, 1, 0, _Error_handler_unexpected_thread),
     ETPU_VECTOR1(0,     x, 1, 0,  0, 0, 1, _Error_handler_unexpected_thread),
@@ -1957,6 +1932,7 @@ DEFINE_ENTRY_TABLE(CRANK, CRANK, alternate, inputpin, autocfsr)
 #pragma write h, (/* Host Service Request Definitions */);
 #pragma write h, (::ETPUliteral(#define FS_ETPU_CRANK_HSR_INIT)         CRANK_HSR_INIT );
 #pragma write h, (::ETPUliteral(#define FS_ETPU_CRANK_HSR_SET_SYNC)     CRANK_HSR_SET_SYNC );
+#pragma write h, (::ETPUliteral(#define FS_ETPU_CRANK_HSR_RESYNC)       CRANK_HSR_RESYNC );
 #pragma write h, ( );
 #pragma write h, (/* Function Mode Bit Definitions */);
 #pragma write h, (::ETPUliteral(#define FS_ETPU_CRANK_FM0_USE_TRANS_RISING)  CRANK_FM0_USE_TRANS_RISING );
@@ -1972,6 +1948,7 @@ DEFINE_ENTRY_TABLE(CRANK, CRANK, alternate, inputpin, autocfsr)
 #pragma write h, (::ETPUliteral(#define FS_ETPU_CRANK_OFFSET_LAST_TOOTH_TCR1_TIME    ) ::ETPUlocation (CRANK, last_tooth_tcr1_time    ) );
 #pragma write h, (::ETPUliteral(#define FS_ETPU_CRANK_OFFSET_LAST_TOOTH_PERIOD       ) ::ETPUlocation (CRANK, last_tooth_period       ) );
 #pragma write h, (::ETPUliteral(#define FS_ETPU_CRANK_OFFSET_LAST_TOOTH_PERIOD_NORM  ) ::ETPUlocation (CRANK, last_tooth_period_norm  ) );
+#pragma write h, (::ETPUliteral(#define FS_ETPU_CRANK_OFFSET_TOOTH_LATENCY_MAX      ) ::ETPUlocation (CRANK, tooth_latency_max       ) );
 #pragma write h, (::ETPUliteral(#define FS_ETPU_CRANK_OFFSET_ADDITIONAL_TOOTH_PERIOD ) ::ETPUlocation (CRANK, additional_tooth_period ) );
 #pragma write h, (::ETPUliteral(#define FS_ETPU_CRANK_OFFSET_TCR2_ADJUSTMENT         ) ::ETPUlocation (CRANK, tcr2_adjustment         ) );
 #pragma write h, (::ETPUliteral(#define FS_ETPU_CRANK_OFFSET_GAP_RATIO               ) ::ETPUlocation (CRANK, gap_ratio               ) );
@@ -1980,6 +1957,7 @@ DEFINE_ENTRY_TABLE(CRANK, CRANK, alternate, inputpin, autocfsr)
 #pragma write h, (::ETPUliteral(#define FS_ETPU_CRANK_OFFSET_WIN_RATIO_AFTER_GAP     ) ::ETPUlocation (CRANK, win_ratio_after_gap     ) );
 #pragma write h, (::ETPUliteral(#define FS_ETPU_CRANK_OFFSET_WIN_RATIO_AFTER_TIMEOUT ) ::ETPUlocation (CRANK, win_ratio_after_timeout ) );
 #pragma write h, (::ETPUliteral(#define FS_ETPU_CRANK_OFFSET_FIRST_TOOTH_TIMEOUT     ) ::ETPUlocation (CRANK, first_tooth_timeout     ) );
+#pragma write h, (::ETPUliteral(#define FS_ETPU_CRANK_OFFSET_STALL_DECEL_RATIO       ) ::ETPUlocation (CRANK, stall_decel_ratio       ) );
 #pragma write h, (::ETPUliteral(#define FS_ETPU_CRANK_OFFSET_LINK_CAM                ) ::ETPUlocation (CRANK, link_cam                ) );
 #pragma write h, (::ETPUliteral(#define FS_ETPU_CRANK_OFFSET_LINK_1                  ) ::ETPUlocation (CRANK, link_1                  ) );
 #pragma write h, (::ETPUliteral(#define FS_ETPU_CRANK_OFFSET_LINK_2                  ) ::ETPUlocation (CRANK, link_2                  ) );
@@ -1996,6 +1974,12 @@ DEFINE_ENTRY_TABLE(CRANK, CRANK, alternate, inputpin, autocfsr)
 #pragma write h, (::ETPUliteral(#define FS_ETPU_CRANK_OFFSET_STATE                   ) ::ETPUlocation (CRANK, state                   ) );
 #pragma write h, (::ETPUliteral(#define FS_ETPU_CRANK_OFFSET_ERROR                   ) ::ETPUlocation (CRANK, error                   ) );
 #pragma write h, (::ETPUliteral(#define FS_ETPU_CRANK_OFFSET_TOOTH_PERIOD_LOG        ) ::ETPUlocation (CRANK, tooth_period_log        ) );
+#pragma write h, (::ETPUliteral(#define FS_ETPU_CRANK_OFFSET_LINK_EXTRA_COUNT        ) ::ETPUlocation (CRANK, link_extra_count        ) );
+#pragma write h, (::ETPUliteral(#define FS_ETPU_CRANK_OFFSET_LINK_EXTRA              ) ::ETPUlocation (CRANK, link_extra              ) );
+#pragma write h, (::ETPUliteral(#define FS_ETPU_CRANK_OFFSET_LINK_DEFERRED_IDX       ) ::ETPUlocation (CRANK, link_deferred_idx       ) );
+#pragma write h, (::ETPUliteral(#define FS_ETPU_CRANK_OFFSET_STALL_DECEL_TEETH       ) ::ETPUlocation (CRANK, stall_decel_teeth       ) );
+#pragma write h, (::ETPUliteral(#define FS_ETPU_CRANK_OFFSET_STALL_DECEL_COUNT       ) ::ETPUlocation (CRANK, stall_decel_count       ) );
+#pragma write h, (::ETPUliteral(#define FS_ETPU_CRANK_OFFSET_STALL_PREDICTED_COUNT   ) ::ETPUlocation (CRANK, stall_predicted_count   ) );
 #ifdef ERRATA_2477
 #pragma write h, (::ETPUliteral(#define FS_ETPU_CRANK_OFFSET_ERR2477_TCR2_TARGET     ) ::ETPUlocation (CRANK, err2477_tcr2_target     ) );
 #endif
@@ -2004,6 +1988,9 @@ DEFINE_ENTRY_TABLE(CRANK, CRANK, alternate, inputpin, autocfsr)
 #pragma write h, (::ETPUliteral(#define FS_ETPU_OFFSET_ENG_POS_STATE                 )  ::ETPUlocation (eng_pos_state) );
 #pragma write h, (::ETPUliteral(#define FS_ETPU_OFFSET_ENG_CYCLE_TCR2_TICKS          )  ::ETPUlocation (eng_cycle_tcr2_ticks) );
 #pragma write h, (::ETPUliteral(#define FS_ETPU_OFFSET_ENG_CYCLE_TCR2_START          )  ::ETPUlocation (eng_cycle_tcr2_start) );
+#pragma write h, (::ETPUliteral(#define FS_ETPU_OFFSET_ENG_TOOTH_PERIOD              )  ::ETPUlocation (eng_tooth_period) );
+#pragma write h, (::ETPUliteral(#define FS_ETPU_OFFSET_ENG_TRR_NORM_HIGHRES          )  ::ETPUlocation (eng_trr_norm_highres) );
+#pragma write h, (::ETPUliteral(#define FS_ETPU_OFFSET_ENG_TOOTH_PERIOD_CHANGE       )  ::ETPUlocation (eng_tooth_period_change) );
 #pragma write h, ( );
 #pragma write h, (/* Errors */);
 #pragma write h, (::ETPUliteral(#define FS_ETPU_CRANK_ERR_NO_ERROR           ) CRANK_ERR_NO_ERROR           );
@@ -2076,6 +2063,44 @@ DEFINE_ENTRY_TABLE(CRANK, CRANK, alternate, inputpin, autocfsr)
  *  REVISION HISTORY:
  *
  *  FILE OWNER: Milan Brejl [r54529]
+ *  Revision 2.1  2026/10/18
+ *  LINKS_DEFERRED sends at most CRANK_LINKS_DEFERRED_MAX link sets per
+ *  service and re-activates itself for the rest. tooth_latency_max is
+ *  free-running, it is not cleared by the CPU any more.
+ *
+ *  Revision 2.0  2026/10/18
+ *  Stall prediction added - a stall is declared after stall_decel_teeth
+ *  consecutive decelerating teeth, or on a timeout while decelerating.
+ *
+ *  Revision 1.9  2026/10/18
+ *  RESYNC HSR added to restart the synchronization on CPU request.
+ *
+ *  Revision 1.8  2026/10/18
+ *  Additional link sets (link_extra) sent from LINKS_DEFERRED, so that
+ *  engines with more than 16 angle-based channels can be linked on stall.
+ *
+ *  Revision 1.7  2026/10/18
+ *  Links link_3 and link_4 deferred to the LINKS_DEFERRED thread on stall
+ *  and ANGLE_ADJUST. Worst-case tooth service latency recorded.
+ *
+ *  Revision 1.6  2026/10/18
+ *  Global eng_tooth_period_change and CRANK_Is_Accelerating added.
+ *
+ *  Revision 1.5  2026/10/18
+ *  CRANK_Time_to_Angle_Adaptive added, selecting the conversion precision by
+ *  the eng_trr_norm_highres threshold.
+ *
+ *  Revision 1.4  2026/10/18
+ *  Global eng_tooth_period published for tooth-referenced timing in other
+ *  functions.
+ *
+ *  Revision 1.3  2026/10/18
+ *  States common to CRANK_WITH_GAP and CRANK_WITH_ADDITIONAL_TOOTH moved to
+ *  shared fragments CommonTransition_NoReturn, CommonTimeout_NoReturn and
+ *  CycleEnd_NoReturn. The additional-tooth variant now logs the tooth period
+ *  after the tooth_counter_cycle reset at the engine-cycle end, as the gap
+ *  variant does (it wrote one item past the tooth_period_log array before).
+ *
  *  Revision 1.2  2015/09/01  r54529
  *  Output parameter last_tooth_period_norm added.
  *
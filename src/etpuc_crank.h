@@ -28,6 +28,7 @@
 /* Host Service Requests */
 #define CRANK_HSR_INIT                  7
 #define CRANK_HSR_SET_SYNC              1
+#define CRANK_HSR_RESYNC                2  /* CRANK only */
 #define CRANK_HSR_SET_SPEED             3  /* CRANK_EMUL only */
 
 /* Function Modes */
@@ -75,6 +76,9 @@
 #define ENG_POS_PRE_FULL_SYNC           2
 #define ENG_POS_FULL_SYNC               3
 
+/* Maximum number of sets of 4 links sent by one LINKS_DEFERRED service */
+#define CRANK_LINKS_DEFERRED_MAX        2
+
 
 /* CRANK eTPU function class declaration */
 _eTPU_class CRANK
@@ -89,6 +93,7 @@ public:
           uint24_t   last_tooth_period;
           uint24_t   last_tooth_period_norm;
           uint24_t   last_last_tooth_period_norm;
+          uint24_t   tooth_latency_max;
           uint24_t   additional_tooth_period;
            int24_t   tcr2_adjustment; 
     const ufract24_t gap_ratio;
@@ -96,6 +101,7 @@ public:
     const ufract24_t win_ratio_across_gap;
     const ufract24_t win_ratio_after_gap;
     const ufract24_t win_ratio_after_timeout;
+    const ufract24_t stall_decel_ratio;
     const uint24_t   first_tooth_timeout; 
     const uint32_t   link_cam;
     const uint32_t   link_1;
@@ -112,7 +118,13 @@ public:
           uint8_t    blank_teeth; 
           uint8_t    state;
           uint8_t    error;
+    const uint8_t    link_extra_count;
+          uint8_t    link_deferred_idx;
+    const uint8_t    stall_decel_teeth;
+          uint8_t    stall_decel_count;
+          uint8_t    stall_predicted_count;
     const uint24_t  *tooth_period_log;
+    const uint32_t  *link_extra;
           int24_t    tcr2_error_at_cycle_start;
 #ifdef ERRATA_2477
            int24_t   err2477_tcr2_target;
@@ -126,6 +138,8 @@ public:
     /* CRANK */
     _eTPU_thread INIT(_eTPU_matches_disabled);
     _eTPU_thread ANGLE_ADJUST(_eTPU_matches_disabled);
+    _eTPU_thread RESYNC(_eTPU_matches_disabled);
+    _eTPU_thread LINKS_DEFERRED(_eTPU_matches_disabled);
     _eTPU_thread CRANK_WITH_GAP(_eTPU_matches_enabled);
     _eTPU_thread CRANK_WITH_ADDITIONAL_TOOTH(_eTPU_matches_enabled);
     _eTPU_thread CRANK_TOOTH_TCR2_SYNC_GAP(_eTPU_matches_enabled);
@@ -145,6 +159,8 @@ public:
     /* common */    
     void ToothArray_Log(register_a uint24_t tooth_period);
     void Set_TRR(register_a uint24_t tooth_period_norm);
+    void ToothLatency_Log(void);
+    int8_t StallPredict(register_a uint24_t tooth_period);
 
     /* CRANK */
     _eTPU_fragment Window_NoReturn(
@@ -159,6 +175,11 @@ public:
         register_d uint24_t tooth_period);
     _eTPU_fragment Stall_NoReturn();
     _eTPU_fragment ToothTcr2Sync_NoReturn();
+    _eTPU_fragment CommonTransition_NoReturn();
+    _eTPU_fragment CommonTimeout_NoReturn();
+    _eTPU_fragment CycleEnd_NoReturn(
+        register_a fract24_t win_ratio,
+        register_d uint24_t tooth_period);
 
     
     /************************************/
@@ -177,6 +198,10 @@ int24_t CRANK_Time_to_Angle_HighRes( /* used by engine timing functions such as
     register_a uint24_t time);
 int24_t CRANK_Time_to_Angle_LowRes( /* used by engine timing functions such as SPARK and FUEL */
     register_a uint24_t time);
+int24_t CRANK_Time_to_Angle_Adaptive( /* used by engine timing functions such as SPARK and FUEL */
+    register_a uint24_t time);
+_Bool CRANK_Is_Accelerating( /* used by engine timing functions such as SPARK and FUEL */
+    register_a ufract24_t accel_ratio);
 
 
 
@@ -188,6 +213,9 @@ extern       uint8_t   eng_pos_state;
 extern const uint24_t  eng_cycle_tcr2_ticks;
 extern       uint24_t  eng_cycle_tcr2_start;
 extern       uint24_t  eng_trr_norm;
+extern       uint24_t  eng_tooth_period;
+extern const uint24_t  eng_trr_norm_highres;
+extern       int24_t   eng_tooth_period_change;
 
 
 #endif /* __ETPUC_CRANK_H */
@@ -226,6 +254,31 @@ extern       uint24_t  eng_trr_norm;
 *  REVISION HISTORY:
 *
 *  FILE OWNER: Milan Brejl [r54529]
+*  Revision 2.0  2026/10/18
+*  Parameter link_deferred_idx and CRANK_LINKS_DEFERRED_MAX added.
+*
+*  Revision 1.9  2026/10/18
+*  Parameters stall_decel_ratio, stall_decel_teeth, stall_decel_count and
+*  stall_predicted_count added for the stall prediction.
+*
+*  Revision 1.8  2026/10/18
+*  CRANK_HSR_RESYNC added.
+*
+*  Revision 1.7  2026/10/18
+*  Parameters link_extra_count and link_extra added.
+*
+*  Revision 1.6  2026/10/18
+*  Thread LINKS_DEFERRED and tooth_latency_max added.
+*
+*  Revision 1.5  2026/10/18
+*  Global eng_tooth_period_change and CRANK_Is_Accelerating added.
+*
+*  Revision 1.4  2026/10/18
+*  Global eng_trr_norm_highres and CRANK_Time_to_Angle_Adaptive added.
+*
+*  Revision 1.3  2026/10/18
+*  Global eng_tooth_period added.
+*
 *  Revision 1.2  2015/09/01  r54529
 *  Output parameter last_tooth_period_norm added.
 *
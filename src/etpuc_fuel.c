@@ -22,9 +22,9 @@
 *  Includes
 *******************************************************************************/
 #include <etpu_std.h>
+#include "etpuc_set.h"    /* LATENESS_BUCKET_COUNT */
 #include "etpuc_fuel.h"
 #include "etpuc_crank.h"   /* global eng_cycle_tcr2_ticks */
-#include "etpuc_set.h"
 
 /*******************************************************************************
 *  eTPU Function Parameters:
@@ -52,6 +52,27 @@
 *  generation_disable - disable/enable injection pulse generation. A value
 *    change is applied from next recalculation angle, finishing the current
 *    engine-cycle unaffected.
+*  end_mode - FUEL_END_MODE_TIME: the injection pulse is generated purely in
+*    time after the start angle. FUEL_END_MODE_ANGLE: the main injection pulse
+*    end is re-evaluated in the middle of the pulse and, if it would miss
+*    angle_normal_end by more than angle_end_tolerance, it is moved to
+*    angle_normal_end.
+*  angle_end_tolerance - TCR2 tolerance of the pulse end angle in
+*    FUEL_END_MODE_ANGLE
+*  end_time_deviation_max - maximum change of the main pulse time caused by
+*    moving the pulse end to angle_normal_end, as a fraction of the pulse
+*    time. The pulse end is limited to this deviation from the time-based end.
+*  recalc_counter - counts extra recalculations of the current start angle
+*  recalc_count_max - maximum count of extra recalculations. They are done
+*    while the engine accelerates or decelerates (see CRANK_Is_Accelerating),
+*    each at a quarter of the previous offset before the start angle.
+*  recalc_accel_ratio - tooth period change ratio which triggers an extra
+*    recalculation
+*  recalc_lead_time - optional TCR1 time of the recalculation lead before
+*    the start angle. If > 0, it is converted to angle every cycle and
+*    bounded by angle_offset_recalc_min and angle_offset_recalc.
+*  angle_offset_recalc_min - minimum TCR2 recalculation offset angle used
+*    with recalc_lead_time
 *
 ********************************************************************************
 *
@@ -103,9 +124,10 @@ _eTPU_fragment FUEL::OnRecalcAngle_NoReturn(void)
 	{
 		/* Re-calculate start angle */
 		tmp = injection_time + compensation_time;
-		tmp = CRANK_Time_to_Angle_HighRes(tmp);
+		tmp = CRANK_Time_to_Angle_Adaptive(tmp);
 		injection_start_angle = tdc_angle_actual - angle_normal_end - tmp;
 		erta = injection_start_angle;
+		LatenessLogStartAngle(erta);
 		
 		/* Output pin action control */
 		if(cc.FM0 == FUEL_FM0_ACTIVE_HIGH)
@@ -139,6 +161,8 @@ _eTPU_fragment FUEL::OnStopAngle_NoReturn(void)
 	injection_time_applied_cpu = injection_time_applied;
 	/* Reset applied injection time */
 	injection_time_applied = 0;
+	is_await_end_recalc = FALSE;
+	is_end_angle_applied = FALSE;
 
 	/* Write injection start angle for CPU reading */
 	injection_start_angle_cpu = tdc_angle_actual - injection_start_angle;
@@ -153,8 +177,8 @@ _eTPU_fragment FUEL::OnStopAngle_NoReturn(void)
 	channel.CIRC = CIRC_INT_FROM_SERVICED;
 
     /* schedule the next start angle calculation */
-    is_first_recalc = TRUE;
-    angle_offset_recalc_working = angle_offset_recalc;
+    recalc_counter = 0;
+    SetRecalcOffset();
     ScheduleRecalc_NoReturn();
 }
 
@@ -223,6 +247,27 @@ _eTPU_fragment FUEL::SchedulePulseEnd_NoReturn(void)
 	/* Schedule PULSE_END */
 	erta = pulse_start_time + tmp;
 	erta += compensation_time;
+	/* In FUEL_END_MODE_ANGLE, schedule END_RECALC in the middle of the main
+	   pulse instead, but not earlier than the minimum injection time.
+	   A pulse end rescheduled by UPDATE_ACTIVE is time-based again, so
+	   an angle-based end applied before does not hold any more. */
+	is_await_end_recalc = FALSE;
+	is_end_angle_applied = FALSE;
+	if((end_mode == FUEL_END_MODE_ANGLE) && (injection_time_applied == 0))
+	{
+		tmp = (tmp + compensation_time) >> 1;
+		if(tmp < injection_time_minimum + compensation_time)
+		{
+			tmp = injection_time_minimum + compensation_time;
+		}
+		if(erta - pulse_start_time > tmp)
+		{
+			erta = pulse_start_time + tmp;
+			/* do not change the output on END_RECALC */
+			channel.OPACA = OPAC_NO_CHANGE;
+			is_await_end_recalc = TRUE;
+		}
+	}
 	channel.TBSA = TBS_M1C1GE;  /* match on time */
 	channel.MRLA = MRL_CLEAR;
 	channel.ERWA = ERW_WRITE_ERT_TO_MATCH;
@@ -238,8 +283,10 @@ _eTPU_fragment FUEL::SchedulePulseEnd_NoReturn(void)
 *******************************************************************************/
 _eTPU_fragment FUEL::ScheduleAdditionalPulse_NoReturn(void)
 {
-	/* Additional pulse needed? */
-	if(injection_time - injection_time_applied > injection_time_minimum)
+	/* Additional pulse needed? Not if the main pulse was ended at
+	   angle_normal_end on purpose (FUEL_END_MODE_ANGLE). */
+	if((injection_time - injection_time_applied > injection_time_minimum) &&
+	   (is_end_angle_applied == FALSE))
 	{
 		/* start the additional pulse at least minimum off time after the previous pulse */
 		erta = pulse_end_time + off_time_minimum;
@@ -258,13 +305,104 @@ _eTPU_fragment FUEL::ScheduleAdditionalPulse_NoReturn(void)
 	}
 }
 
+/*******************************************************************************
+*  FUNCTION NAME: OnEndRecalc_NoReturn
+*  DESCRIPTION: END_RECALC in the middle of the main pulse (FUEL_END_MODE_ANGLE).
+*               Predict the angle of the time-based pulse end using the actual
+*               engine speed. If it misses angle_normal_end by more than
+*               angle_end_tolerance, schedule PULSE_END at angle_normal_end,
+*               otherwise schedule PULSE_END in time.
+*               The angle-based end may shorten or stretch the pulse by
+*               end_time_deviation_max of the pulse time at most, beyond that
+*               PULSE_END is scheduled in time at the deviation limit.
+*******************************************************************************/
+_eTPU_fragment FUEL::OnEndRecalc_NoReturn(void)
+{
+	int24_t tmp;
+	int24_t end_angle;
+	int24_t limit_time;
+	int24_t limit_angle;
+	int24_t deviation;
+
+	is_await_end_recalc = FALSE;
+
+	/* Output pin action control */
+	if(cc.FM0 == FUEL_FM0_ACTIVE_HIGH)
+	{
+		channel.OPACA = OPAC_MATCH_LOW;
+	}
+	else
+	{
+		channel.OPACA = OPAC_MATCH_HIGH;
+	}
+	/* Time-based pulse end, including a possible injection_time update */
+	tmp = injection_time - injection_time_applied;
+	if(tmp < injection_time_minimum)
+	{
+		tmp = injection_time_minimum;
+	}
+	deviation = muliur(tmp, end_time_deviation_max);
+	tmp += pulse_start_time + compensation_time;
+	erta = tmp;
+	channel.TBSA = TBS_M1C1GE;  /* match on time */
+
+	/* Predict the angle error of the time-based pulse end */
+	end_angle = tdc_angle_actual - angle_normal_end;
+	tmp -= tcr1;
+	if(tmp > 0)
+	{
+		tmp = tcr2 + CRANK_Time_to_Angle_Adaptive(tmp) - end_angle;
+		if((tmp > angle_end_tolerance) || (tmp < -angle_end_tolerance))
+		{
+			/* Find the time limit of the pulse end on the side of
+			   angle_normal_end: shorten not below injection_time_minimum */
+			limit_time = erta + deviation;
+			if(tmp > 0)
+			{
+				limit_time = erta - deviation;
+				if(limit_time - pulse_start_time - compensation_time
+				   < injection_time_minimum)
+				{
+					limit_time = pulse_start_time + compensation_time
+					           + injection_time_minimum;
+				}
+			}
+			/* Predict the angle of the time limit */
+			limit_angle = tcr2;
+			if(limit_time - tcr1 > 0)
+			{
+				limit_angle += CRANK_Time_to_Angle_Adaptive(limit_time - tcr1);
+			}
+			if(((tmp > 0) && (end_angle - limit_angle < 0))
+			   || ((tmp < 0) && (end_angle - limit_angle > 0)))
+			{
+				/* Schedule PULSE_END in time at the deviation limit */
+				erta = limit_time;
+			}
+			else
+			{
+				/* Schedule PULSE_END at angle_normal_end */
+				erta = end_angle;
+				channel.TBSA = TBS_M2C1GE;  /* match on angle */
+			}
+			is_end_angle_applied = TRUE;
+			/* set error flag */
+			error |= FUEL_ERROR_END_ANGLE_APPLIED;
+		}
+	}
+	channel.MRLA = MRL_CLEAR;
+	channel.ERWA = ERW_WRITE_ERT_TO_MATCH;
+}
+
 /*******************************************************************************
 *  FUNCTION NAME: OnPulseEnd
-*  DESCRIPTION: Record pulse end time.
+*  DESCRIPTION: Record end edge lateness and pulse end time.
 *               Update applied injection time.
 *******************************************************************************/
 void FUEL::OnPulseEnd(void)
 {
+	/* Record end edge lateness - all pulse end paths come here */
+	LatenessLog(tcr1 - erta);
 	/* Record pulse end time */
 	pulse_end_time = erta;
 	/* Add pulse width to applied injection time, remove compensation time */
@@ -276,6 +414,62 @@ void FUEL::OnPulseEnd(void)
 	channel.FLAG0 = FUEL_FLAG0_INJ_NOT_ACTIVE;
 }
 
+/*******************************************************************************
+*  FUNCTION NAME: SetRecalcOffset
+*  DESCRIPTION: Set the working recalculation offset angle. If recalc_lead_time
+*               is set, it is converted to angle using the current engine
+*               speed and bounded by angle_offset_recalc_min and
+*               angle_offset_recalc, otherwise angle_offset_recalc is used.
+*******************************************************************************/
+void FUEL::SetRecalcOffset(void)
+{
+	int24_t tmp;
+
+	tmp = angle_offset_recalc;
+	if(recalc_lead_time > 0)
+	{
+		tmp = CRANK_Time_to_Angle_LowRes(recalc_lead_time);
+		if(tmp < angle_offset_recalc_min)
+		{
+			tmp = angle_offset_recalc_min;
+		}
+		else if(tmp > angle_offset_recalc)
+		{
+			tmp = angle_offset_recalc;
+		}
+	}
+	angle_offset_recalc_working = tmp;
+}
+
+/*******************************************************************************
+*  FUNCTION NAME: LatenessLog
+*  DESCRIPTION: If enabled (lateness_bucket_time > 0), increment the lateness
+*    histogram bucket which corresponds to the output edge service lateness.
+*    The bucket counters are free-running, the CPU accumulates differences.
+*******************************************************************************/
+void FUEL::LatenessLog(register_a uint24_t lateness)
+{
+	if(lateness_bucket_time > 0)
+	{
+		lateness_hist[Lateness_Bucket(lateness, lateness_bucket_time)]++;
+	}
+}
+
+/*******************************************************************************
+*  FUNCTION NAME: LatenessLogStartAngle
+*  DESCRIPTION: If the start angle being scheduled is already over, the start
+*    edge comes late by more than the service latency. Record it as
+*    LATENESS_IN_PAST now and let the start edge service skip its record.
+*******************************************************************************/
+void FUEL::LatenessLogStartAngle(register_a int24_t start_angle)
+{
+	lateness_in_past = FALSE;
+	if(start_angle - (int24_t)tcr2 < 0)
+	{
+		LatenessLog(LATENESS_IN_PAST);
+		lateness_in_past = TRUE;
+	}
+}
 
 
 /*******************************************************************************
@@ -327,7 +521,9 @@ _eTPU_thread FUEL::INIT(_eTPU_matches_disabled)
 	channel.FLAG0 = FUEL_FLAG0_INJ_NOT_ACTIVE;
 	channel.FLAG1 = FUEL_FLAG1_RECALC_ANGLE;
 	is_await_recalc = TRUE;
-	angle_offset_recalc_working = angle_offset_recalc;
+	is_await_end_recalc = FALSE;
+	is_end_angle_applied = FALSE;
+	SetRecalcOffset();
 
     if (eng_pos_state != ENG_POS_FULL_SYNC)
     {
@@ -340,7 +536,7 @@ _eTPU_thread FUEL::INIT(_eTPU_matches_disabled)
 	angle_stop_actual_last = tdc_angle_actual - angle_stop - eng_cycle_tcr2_ticks;
 	
 	/* Calculate the first start angle */
-    is_first_recalc = TRUE;
+    recalc_counter = 0;
 	tmp = injection_time + compensation_time;
 	tmp = CRANK_Time_to_Angle_LowRes(tmp);
 	injection_start_angle = tdc_angle_actual - angle_normal_end - tmp;
@@ -436,6 +632,12 @@ _eTPU_thread FUEL::UPDATE_ACTIVE(_eTPU_matches_disabled)
 	   and PULSE_END service - check match A latch. */
 	if(cc.MRLA)
 	{
+		if(is_await_end_recalc)
+		{
+			/* the pending match is END_RECALC, it takes the update into account */
+			OnEndRecalc_NoReturn();
+		}
+
 		/* service PULSE_END first */
 		OnPulseEnd();
 		
@@ -455,15 +657,26 @@ _eTPU_thread FUEL::UPDATE_ACTIVE(_eTPU_matches_disabled)
 **************************************************************************/
 _eTPU_thread FUEL::PULSE_START(_eTPU_matches_disabled)
 {
+	/* Record start edge lateness, unless already recorded as in the past */
+	if(lateness_in_past == FALSE)
+	{
+		LatenessLog(tcr1 - erta);
+	}
+	lateness_in_past = FALSE;
 	SchedulePulseEnd_NoReturn();
 }
 
 /**************************************************************************
 * THREAD NAME: PULSE_END
-* DESCRIPTION: End of main or additional injection pulse.
+* DESCRIPTION: End of main or additional injection pulse,
+*              or END_RECALC in the middle of the main pulse.
 **************************************************************************/
 _eTPU_thread FUEL::PULSE_END(_eTPU_matches_disabled)
 {
+	if(is_await_end_recalc)
+	{
+		OnEndRecalc_NoReturn();
+	}
 	OnPulseEnd();
 }
 
@@ -498,9 +711,11 @@ _eTPU_thread FUEL::STOP_ANGLE_ACTIVE(_eTPU_matches_disabled)
 **************************************************************************/
 _eTPU_thread FUEL::RECALC_ANGLE(_eTPU_matches_disabled)
 {
-    if (is_first_recalc)
+    if ((recalc_counter < recalc_count_max) &&
+        CRANK_Is_Accelerating(recalc_accel_ratio))
     {
-        is_first_recalc = FALSE;
+        /* Schedule an extra RECALC_ANGLE closer to the start angle */
+        recalc_counter++;
         angle_offset_recalc_working >>= 2;
         ScheduleRecalc_NoReturn();
     }
@@ -597,6 +812,9 @@ DEFINE_ENTRY_TABLE(FUEL, FUEL, alternate, outputpin, autocfsr)
 #pragma write h, (::ETPUliteral(#define FS_ETPU_FUEL_TABLE_SELECT) ::ETPUentrytype(FUEL) );
 #pragma write h, (::ETPUliteral(#define FS_ETPU_FUEL_NUM_PARMS) ::ETPUram(FUEL) );
 #pragma write h, ( );
+#pragma write h, (/* Lateness Histogram Definitions, common to SPARK, FUEL and INJ */);
+#pragma write h, (::ETPUliteral(#define FS_ETPU_LATENESS_BUCKET_COUNT) LATENESS_BUCKET_COUNT );
+#pragma write h, ( );
 #pragma write h, (/* Host Service Request Definitions */);
 #pragma write h, (::ETPUliteral(#define FS_ETPU_FUEL_HSR_INIT)        FUEL_HSR_INIT );
 #pragma write h, (::ETPUliteral(#define FS_ETPU_FUEL_HSR_STOP)        FUEL_HSR_STOP );
@@ -624,15 +842,29 @@ DEFINE_ENTRY_TABLE(FUEL, FUEL, alternate, outputpin, autocfsr)
 #pragma write h, (::ETPUliteral(#define FS_ETPU_FUEL_OFFSET_PULSE_START_TIME          ) ::ETPUlocation (FUEL, pulse_start_time ) );
 #pragma write h, (::ETPUliteral(#define FS_ETPU_FUEL_OFFSET_PULSE_END_TIME            ) ::ETPUlocation (FUEL, pulse_end_time ) );
 #pragma write h, (::ETPUliteral(#define FS_ETPU_FUEL_OFFSET_GENERATION_DISABLE        ) ::ETPUlocation (FUEL, generation_disable ) );
+#pragma write h, (::ETPUliteral(#define FS_ETPU_FUEL_OFFSET_END_MODE                  ) ::ETPUlocation (FUEL, end_mode ) );
+#pragma write h, (::ETPUliteral(#define FS_ETPU_FUEL_OFFSET_ANGLE_END_TOLERANCE       ) ::ETPUlocation (FUEL, angle_end_tolerance ) );
+#pragma write h, (::ETPUliteral(#define FS_ETPU_FUEL_OFFSET_END_TIME_DEVIATION_MAX    ) ::ETPUlocation (FUEL, end_time_deviation_max ) );
+#pragma write h, (::ETPUliteral(#define FS_ETPU_FUEL_OFFSET_RECALC_COUNT_MAX          ) ::ETPUlocation (FUEL, recalc_count_max ) );
+#pragma write h, (::ETPUliteral(#define FS_ETPU_FUEL_OFFSET_RECALC_ACCEL_RATIO         ) ::ETPUlocation (FUEL, recalc_accel_ratio ) );
+#pragma write h, (::ETPUliteral(#define FS_ETPU_FUEL_OFFSET_RECALC_LEAD_TIME           ) ::ETPUlocation (FUEL, recalc_lead_time ) );
+#pragma write h, (::ETPUliteral(#define FS_ETPU_FUEL_OFFSET_ANGLE_OFFSET_RECALC_MIN    ) ::ETPUlocation (FUEL, angle_offset_recalc_min ) );
+#pragma write h, (::ETPUliteral(#define FS_ETPU_FUEL_OFFSET_LATENESS_BUCKET_TIME      ) ::ETPUlocation (FUEL, lateness_bucket_time ) );
+#pragma write h, (::ETPUliteral(#define FS_ETPU_FUEL_OFFSET_LATENESS_HIST             ) ::ETPUlocation (FUEL, lateness_hist ) );
 #pragma write h, ( );
 #pragma write h, (/* Error Flags Definitions */);
 #pragma write h, (::ETPUliteral(#define FS_ETPU_FUEL_ERROR_STOP_ANGLE_APPLIED)       FUEL_ERROR_STOP_ANGLE_APPLIED);
 #pragma write h, (::ETPUliteral(#define FS_ETPU_FUEL_ERROR_MINIMUM_INJ_TIME_APPLIED) FUEL_ERROR_MINIMUM_INJ_TIME_APPLIED);
+#pragma write h, (::ETPUliteral(#define FS_ETPU_FUEL_ERROR_END_ANGLE_APPLIED)        FUEL_ERROR_END_ANGLE_APPLIED);
 #pragma write h, ( );
 #pragma write h, (/* Generation Disable Definitions */);
 #pragma write h, (::ETPUliteral(#define FS_ETPU_FUEL_GENERATION_ALLOWED)             FUEL_GENERATION_ALLOWED);
 #pragma write h, (::ETPUliteral(#define FS_ETPU_FUEL_GENERATION_DISABLED)            FUEL_GENERATION_DISABLED);
 #pragma write h, ( );
+#pragma write h, (/* End Mode Definitions */);
+#pragma write h, (::ETPUliteral(#define FS_ETPU_FUEL_END_MODE_TIME)                  FUEL_END_MODE_TIME);
+#pragma write h, (::ETPUliteral(#define FS_ETPU_FUEL_END_MODE_ANGLE)                 FUEL_END_MODE_ANGLE);
+#pragma write h, ( );
 #pragma write h, (#endif );
 
 /*********************************************************************
@@ -670,6 +902,29 @@ DEFINE_ENTRY_TABLE(FUEL, FUEL, alternate, outputpin, autocfsr)
 *  REVISION HISTORY:
 *
 *  FILE OWNER: Milan Brejl [r54529]
+*  Revision 1.6  2026/10/18
+*  The angle-based pulse end in FUEL_END_MODE_ANGLE is limited to
+*  end_time_deviation_max from the time-based end.
+*
+*  Revision 1.5  2026/10/18
+*  Output edge lateness histogram added.
+*
+*  Revision 1.4  2026/10/18
+*  Optional time-based recalculation lead (recalc_lead_time), bounded by
+*  angle_offset_recalc_min and angle_offset_recalc.
+*
+*  Revision 1.3  2026/10/18
+*  The count of extra start angle recalculations adapts to the engine
+*  acceleration, up to recalc_count_max.
+*
+*  Revision 1.2  2026/10/18
+*  Start angle and end angle prediction conversion precision selected by
+*  engine speed.
+*
+*  Revision 1.1  2026/10/18
+*  End mode FUEL_END_MODE_ANGLE added - the main pulse end is re-evaluated
+*  in the middle of the pulse and moved to angle_normal_end if needed.
+*
 *  Revision 1.0  2014/03/16  r54529
 *  Minor comment and formating improvements. MISRA compliancy check.
 *  Ready for eTPU Engine Control Library release 1.0.
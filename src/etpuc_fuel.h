@@ -33,11 +33,16 @@
 /* Error Flags */
 #define FUEL_ERROR_STOP_ANGLE_APPLIED        0x01
 #define FUEL_ERROR_MINIMUM_INJ_TIME_APPLIED  0x02
+#define FUEL_ERROR_END_ANGLE_APPLIED         0x04
 
 /* Generation Disable flags */
 #define FUEL_GENERATION_ALLOWED        0
 #define FUEL_GENERATION_DISABLED       1
 
+/* End Mode values */
+#define FUEL_END_MODE_TIME             0
+#define FUEL_END_MODE_ANGLE            1
+
 
 /* FUEL eTPU function class declaration */
 _eTPU_class FUEL
@@ -64,7 +69,19 @@ public:
          int24_t angle_stop_actual_last;
          int24_t angle_offset_recalc_working;
          _Bool   is_await_recalc;
-         _Bool   is_first_recalc;
+         uint8_t recalc_counter;
+  const  uint8_t recalc_count_max;
+  const ufract24_t recalc_accel_ratio;
+  const uint24_t recalc_lead_time;
+  const  int24_t angle_offset_recalc_min;
+  const  uint8_t end_mode;
+  const  int24_t angle_end_tolerance;
+  const ufract24_t end_time_deviation_max;
+         _Bool   is_await_end_recalc;
+         _Bool   is_end_angle_applied;
+  const uint24_t lateness_bucket_time;
+        uint24_t lateness_hist[LATENESS_BUCKET_COUNT];
+        _Bool    lateness_in_past;
 
 
     /************************************/
@@ -91,7 +108,11 @@ public:
     _eTPU_fragment ScheduleRecalc_NoReturn(void);
     _eTPU_fragment SchedulePulseEnd_NoReturn(void);
     _eTPU_fragment ScheduleAdditionalPulse_NoReturn(void);
+    _eTPU_fragment OnEndRecalc_NoReturn(void);
     void OnPulseEnd(void);
+    void SetRecalcOffset(void);
+    void LatenessLog(register_a uint24_t lateness);
+    void LatenessLogStartAngle(register_a int24_t start_angle);
     
     
     /************************************/
@@ -138,6 +159,16 @@ public:
 *  REVISION HISTORY:
 *
 *  FILE OWNER: Milan Brejl [r54529]
+*  Revision 1.3  2026/10/18
+*  Parameter end_time_deviation_max added.
+*
+*  Revision 1.2  2026/10/18
+*  Output edge lateness histogram parameters added.
+*
+*  Revision 1.1  2026/10/18
+*  End mode, adaptive recalculation count and time-based recalculation lead
+*  parameters added.
+*
 *  Revision 1.0  2014/03/06  r54529
 *  Minor comment and formating improvements. MISRA compliancy check.
 *  Ready for eTPU Engine Control Library release 1.0.
@@ -60,9 +60,9 @@
 *  Includes
 *******************************************************************************/
 #include <etpu_std.h>
+#include "etpuc_set.h"    /* LATENESS_BUCKET_COUNT */
 #include "etpuc_inj.h"
 #include "etpuc_crank.h"
-#include "etpuc_set.h"
 
 /*******************************************************************************
 *  eTPU Function Parameters:
@@ -176,6 +176,7 @@ void INJ::ScheduleStartAngle1st(void)
 			/* The start-angle is over, skip the rest of injections */
 			/* Set error flag */
 			error |= INJ_ERROR_LATE_START_ANGLE_1ST;
+			LatenessLog(LATENESS_IN_PAST);
 		}
 	}
 }
@@ -304,6 +305,7 @@ _eTPU_fragment INJ::Phase_NoReturn(void)
 				/* The start-angle is over, skip the rest of injections */
 				/* Set error flag */
 				error |= INJ_ERROR_LATE_START_ANGLE_NTH;
+				LatenessLog(LATENESS_IN_PAST);
 				/* Free BANK channels for other injectors */
 				inj_global.active_bank_chans.parts.bits31_24 &= ~bank_chans_mask.parts.bits31_24;
 				inj_global.active_bank_chans.parts.bits23_0  &= ~bank_chans_mask.parts.bits23_0;
@@ -461,6 +463,19 @@ _eTPU_fragment INJ::Init_NoReturn(void)
 	}
 }
 
+/*******************************************************************************
+*  FUNCTION NAME: LatenessLog
+*  DESCRIPTION: If enabled (lateness_bucket_time > 0), increment the lateness
+*    histogram bucket which corresponds to the output edge service lateness.
+*    The bucket counters are free-running, the CPU accumulates differences.
+*******************************************************************************/
+void INJ::LatenessLog(register_a uint24_t lateness)
+{
+	if(lateness_bucket_time > 0)
+	{
+		lateness_hist[Lateness_Bucket(lateness, lateness_bucket_time)]++;
+	}
+}
 
 /*******************************************************************************
 *  eTPU Function
@@ -591,6 +606,8 @@ _eTPU_thread INJ::START_ANGLE_1ST(_eTPU_matches_disabled)
 				}
 			}
 			chan = inj_chan;
+			/* Record start edge lateness - the pins were set by this service */
+			LatenessLog(tcr1 - erta);
 			erta = tcr1;
 
 			/* Process as a normal PHASE */
@@ -617,6 +634,8 @@ _eTPU_thread INJ::PHASE(_eTPU_matches_disabled)
 	}
     else
     {
+        /* Record phase edge lateness */
+        LatenessLog(tcr1 - erta);
         Phase_NoReturn();
     }
 }
@@ -816,6 +835,9 @@ DEFINE_ENTRY_TABLE(INJ, INJ, alternate, outputpin, autocfsr)
 #pragma write h, (::ETPUliteral(#define FS_ETPU_INJ_TABLE_SELECT) ::ETPUentrytype(INJ) );
 #pragma write h, (::ETPUliteral(#define FS_ETPU_INJ_NUM_PARMS) ::ETPUram(INJ) );
 #pragma write h, ( );
+#pragma write h, (/* Lateness Histogram Definitions, common to SPARK, FUEL and INJ */);
+#pragma write h, (::ETPUliteral(#define FS_ETPU_LATENESS_BUCKET_COUNT) LATENESS_BUCKET_COUNT );
+#pragma write h, ( );
 #pragma write h, (/* Host Service Request Definitions */);
 #pragma write h, (::ETPUliteral(#define FS_ETPU_INJ_HSR_INIT)         INJ_HSR_INIT );
 #pragma write h, (::ETPUliteral(#define FS_ETPU_INJ_HSR_UPDATE)       INJ_HSR_UPDATE );
@@ -843,6 +865,8 @@ DEFINE_ENTRY_TABLE(INJ, INJ, alternate, outputpin, autocfsr)
 #pragma write h, (::ETPUliteral(#define FS_ETPU_INJ_OFFSET_ANGLE_STOP)        ::ETPUlocation (INJ, angle_stop) );
 #pragma write h, (::ETPUliteral(#define FS_ETPU_INJ_OFFSET_TDC_ANGLE)         ::ETPUlocation (INJ, tdc_angle) );
 #pragma write h, (::ETPUliteral(#define FS_ETPU_INJ_OFFSET_TDC_ANGLE_ACTUAL)  ::ETPUlocation (INJ, tdc_angle_actual) );
+#pragma write h, (::ETPUliteral(#define FS_ETPU_INJ_OFFSET_LATENESS_BUCKET_TIME) ::ETPUlocation (INJ, lateness_bucket_time) );
+#pragma write h, (::ETPUliteral(#define FS_ETPU_INJ_OFFSET_LATENESS_HIST)     ::ETPUlocation (INJ, lateness_hist) );
 #pragma write h, ( );
 #pragma write h, (/* Global Variable Definitions */);
 #pragma write h, (::ETPUliteral(#define FS_ETPU_INJ_OFFSET_ACTIVE_BANK_CHANS) ::ETPUlocation (inj_global.active_bank_chans) );
@@ -903,6 +927,9 @@ DEFINE_ENTRY_TABLE(INJ, INJ, alternate, outputpin, autocfsr)
 *  REVISION HISTORY:
 *
 *  FILE OWNER: Milan Brejl [r54529]
+*  Revision 1.3  2026/10/18
+*  Output edge lateness histogram added.
+*
 *  Revision 1.2  2018/09/12  nxa17216
 *  Bug fix: missing injection happening regularly with error 
 *  FS_ETPU_INJ_ERROR_LATE_START_ANGLE_1ST. Condition code for checking
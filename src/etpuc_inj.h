@@ -106,6 +106,8 @@ public:
 	const  int24_t angle_stop;       /* TDC-relative TCR2 latest stop angle */
 	const  int24_t tdc_angle;        /* TCR2 angle relative to engine-cycle start */
 	       int24_t tdc_angle_actual; /* absolute TDC TCR2 angle */
+	const uint24_t lateness_bucket_time; /* TCR1 limit of the first lateness bucket */
+	      uint24_t lateness_hist[LATENESS_BUCKET_COUNT];  /* free-running lateness histogram bucket counters */
 
 
     /************************************/
@@ -128,6 +130,7 @@ public:
     
     void ScheduleStartAngle1st(void);
     void ScheduleIRQAngle(void);
+    void LatenessLog(register_a uint24_t lateness);
     _eTPU_fragment StopBankChannels_NoReturn(void);
     _eTPU_fragment Phase_NoReturn(void);
     _eTPU_fragment Init_NoReturn(void);
@@ -178,6 +181,9 @@ public:
 *  REVISION HISTORY:
 *
 *  FILE OWNER: Milan Brejl [r54529]
+*  Revision 1.2  2026/10/18
+*  Output edge lateness histogram parameters added.
+*
 *  Revision 1.1  2014/12/15  r54529
 *  Union INJ_32_BIT added to enable bank_chans_mask functionality over all 
 *  32 bits (thanks to AshWare).
@@ -55,6 +55,27 @@ void Link4(register_p31_0 link_chans)
     link = p7_0;
 }
 
+/*******************************************************************************
+*  FUNCTION NAME: Lateness_Bucket
+*  DESCRIPTION: Classifies the lateness of an output edge service into one of
+*    LATENESS_BUCKET_COUNT histogram buckets. The bucket limits are
+*    bucket_time, 4*bucket_time and 16*bucket_time. The last bucket includes
+*    everything above, including matches which were already in the past.
+*******************************************************************************/
+uint8_t Lateness_Bucket(
+    register_a uint24_t lateness,
+    register_d uint24_t bucket_time)
+{
+    uint8_t bucket = 0;
+
+    while ((bucket < (LATENESS_BUCKET_COUNT - 1)) && (lateness >= bucket_time))
+    {
+        bucket++;
+        bucket_time <<= 2;
+    }
+    return bucket;
+}
+
 
 /*******************************************************************************
 *  Output eTPU code image and information for CPU 
@@ -150,6 +171,9 @@ void Link4(register_p31_0 link_chans)
 *  REVISION HISTORY:
 *
 *  FILE OWNER: Milan Brejl [r54529]
+*  Revision 1.1  2026/10/18
+*  Lateness_Bucket added.
+*
 *  Revision 1.0  2014/03/16  r54529
 *  Minor comment and formating improvements. MISRA compliancy check.
 *  Ready for release 1.0.
@@ -23,12 +23,18 @@
 /*******************************************************************************
 *  Definitions
 *******************************************************************************/
+/* Output edge lateness histogram */
+#define LATENESS_BUCKET_COUNT   4
+#define LATENESS_IN_PAST        0xffffff
 
 /*******************************************************************************
    Function Prototypes
 *******************************************************************************/
 
 void Link4(register_p31_0 link_chans);
+uint8_t Lateness_Bucket(
+    register_a uint24_t lateness,
+    register_d uint24_t bucket_time);
 
 
 #endif /* _ETPUC_SET_H_ */
@@ -67,6 +73,9 @@ void Link4(register_p31_0 link_chans);
 *  REVISION HISTORY:
 *
 *  FILE OWNER: Milan Brejl [r54529]
+*  Revision 1.1  2026/10/18
+*  Lateness_Bucket added.
+*
 *  Revision 1.0  2014/03/06  r54529
 *  Minor comment and formating improvements. MISRA compliancy check.
 *  Ready for release 1.0.
@@ -38,6 +38,17 @@
 *    
 *    The SPARK function generates channel interrupts at each Recalculation Angle
 *    thread - angle_offset_recalc before the estimated start angle.
+*    While the engine accelerates or decelerates (see CRANK_Is_Accelerating),
+*    up to recalc_count_max extra recalculations are done, each at a quarter
+*    of the previous offset before the start angle.
+*
+*    At cranking speeds, when the CRANK tooth period (eng_tooth_period) is
+*    longer than cranking_tooth_period, the TCR2 angle extrapolated using TRR
+*    is not accurate enough to end the spark on. In this cranking mode, the
+*    spark main pulse end is scheduled as a TCR1 time cranking_delay after
+*    the edge of the reference tooth at cranking_tooth_angle. The TCR1 time
+*    of the reference tooth edge is captured by an angle match on the tooth
+*    TCR2 angle. Above the cranking speed, the normal end_angle is used.
 *
 *******************************************************************************/
 
@@ -45,9 +56,9 @@
 *  Includes
 *******************************************************************************/
 #include <etpu_std.h>
+#include "etpuc_set.h"    /* LATENESS_BUCKET_COUNT */
 #include "etpuc_spark.h"
 #include "etpuc_crank.h"   /* global eng_cycle_tcr2_ticks */
-#include "etpuc_set.h"
 
 /*******************************************************************************
 *  eTPU Function Parameters:
@@ -80,6 +91,21 @@
 *  generation_disable - disable/enable injection pulse generation. A value
 *    change is applied from next recalculation angle, finishing the current
 *    engine-cycle unaffected.
+*  recalc_counter - counts extra recalculations of the current spark
+*  recalc_count_max - maximum count of extra recalculations
+*  recalc_accel_ratio - tooth period change ratio which triggers an extra
+*    recalculation
+*  recalc_lead_time - optional TCR1 time of the recalculation lead before
+*    the start angle. If > 0, it is converted to angle every cycle and
+*    bounded by angle_offset_recalc_min and angle_offset_recalc.
+*  angle_offset_recalc_min - minimum TCR2 recalculation offset angle used
+*    with recalc_lead_time
+*  cranking_tooth_angle - TCR2 angle of the reference tooth edge relative to
+*    tdc_angle, used in cranking mode. It must be a tooth boundary angle.
+*  cranking_delay - TCR1 time from the reference tooth edge to the spark main
+*    pulse end, used in cranking mode.
+*  cranking_tooth_period - TCR1 tooth period threshold. The cranking mode is
+*    applied while eng_tooth_period is longer. 0 disables the cranking mode.
 *    
 *  Single Spark Structure Parameters (struct SINGLE_SPARK)
 *  -------------------------------------------------------
@@ -144,8 +170,8 @@ _eTPU_fragment SPARK::ScheduleNextRecalcAngle_NoReturn(void)
 	channel.FLAG1 = SPARK_FLAG1_POST_MIN_DWELL;
 	
 	/* schedule the recalc */
-	is_first_recalc = TRUE;
-	angle_offset_recalc_working = angle_offset_recalc;
+	recalc_counter = 0;
+	SetRecalcOffset();
 	ScheduleRecalcAngle_NoReturn();
 }
 
@@ -183,8 +209,9 @@ _eTPU_fragment SPARK::ScheduleStartAngle_NoReturn(void)
 
 	/* Re-Calculate start angle */
 	tmp = dwell_time;
-	tmp = CRANK_Time_to_Angle_HighRes(tmp);
+	tmp = CRANK_Time_to_Angle_Adaptive(tmp);
 	ertb = tdc_angle_actual - end_angle - tmp;
+	LatenessLogStartAngle(ertb);
 
 	/* Configure action unit */
 	channel.TBSB = TBS_M2C1GE;
@@ -247,6 +274,8 @@ _eTPU_fragment SPARK::ScheduleMinDwellTime_NoReturn(void)
 *******************************************************************************/
 _eTPU_fragment SPARK::ScheduleEndAngleAndMaxDwellTime_NoReturn(void)
 {
+	int24_t tmp;
+
 	/* Configure action unit */
 	channel.PDCM = PDCM_EM_B_ST; /* either match blocking single transition */
 	channel.TBSA = TBS_M1C1GE;   /* match on TCR1, capture TCR1, greater-equal */
@@ -265,17 +294,61 @@ _eTPU_fragment SPARK::ScheduleEndAngleAndMaxDwellTime_NoReturn(void)
 	channel.ERWA = ERW_WRITE_ERT_TO_MATCH;
 	/* Schedule END_ANGLE */
 	ertb = tdc_angle_actual - end_angle;
-	channel.MRLB = MRL_CLEAR;
-	channel.ERWB = ERW_WRITE_ERT_TO_MATCH;
-
 	/* Spark state */
 	state = SPARK_STATE_MAX_DWELL;
+	/* At cranking speed, schedule the reference tooth instead,
+	   provided it has not passed yet */
+	if((cranking_tooth_period > 0) &&
+	   (eng_tooth_period > cranking_tooth_period))
+	{
+		tmp = tdc_angle_actual - cranking_tooth_angle;
+		if(tmp - tcr2 > 0)
+		{
+			ertb = tmp;
+			channel.OPACB = OPAC_NO_CHANGE;
+			state = SPARK_STATE_CRANKING_TOOTH;
+		}
+	}
+	channel.MRLB = MRL_CLEAR;
+	channel.ERWB = ERW_WRITE_ERT_TO_MATCH;
 
 	/* Channel flags */
 	channel.FLAG0 = SPARK_FLAG0_MAIN_PULSE;
 	channel.FLAG1 = SPARK_FLAG1_POST_MIN_DWELL;
 }
 
+/*******************************************************************************
+*  FUNCTION NAME: ScheduleCrankingEndTime_NoReturn
+*  DESCRIPTION: Re-schedule MAX_DWELL_TIME to match A and schedule the end
+*               time cranking_delay after the reference tooth on B.
+*               Note: The captured TCR1 time of the reference tooth edge must
+*               be in ertb register.
+*******************************************************************************/
+_eTPU_fragment SPARK::ScheduleCrankingEndTime_NoReturn(void)
+{
+	/* Configure action unit */
+	channel.TBSB = TBS_M1C1GE;
+	if(cc.FM0 == SPARK_FM0_ACTIVE_HIGH)
+	{
+		channel.OPACB = OPAC_MATCH_LOW;
+	}
+	else
+	{
+		channel.OPACB = OPAC_MATCH_HIGH;
+	}
+	/* Re-schedule MAX_DWELL, blocked by the reference tooth match */
+	erta = pulse_start_time + dwell_time_max;
+	channel.MRLA = MRL_CLEAR;
+	channel.ERWA = ERW_WRITE_ERT_TO_MATCH;
+	/* Schedule the end time */
+	ertb = ertb + cranking_delay;
+	channel.MRLB = MRL_CLEAR;
+	channel.ERWB = ERW_WRITE_ERT_TO_MATCH;
+
+	/* Spark state */
+	state = SPARK_STATE_CRANKING_END;
+}
+
 /*******************************************************************************
 *  FUNCTION NAME: ScheduleMultiPulse_NoReturn
 *  DESCRIPTION: Schedule MULTI_PULSE.
@@ -349,6 +422,62 @@ void SPARK::ReadSparkParams(void)
 	dwell_time = ertb;
 }
 
+/*******************************************************************************
+*  FUNCTION NAME: SetRecalcOffset
+*  DESCRIPTION: Set the working recalculation offset angle. If recalc_lead_time
+*               is set, it is converted to angle using the current engine
+*               speed and bounded by angle_offset_recalc_min and
+*               angle_offset_recalc, otherwise angle_offset_recalc is used.
+*******************************************************************************/
+void SPARK::SetRecalcOffset(void)
+{
+	int24_t tmp;
+
+	tmp = angle_offset_recalc;
+	if(recalc_lead_time > 0)
+	{
+		tmp = CRANK_Time_to_Angle_LowRes(recalc_lead_time);
+		if(tmp < angle_offset_recalc_min)
+		{
+			tmp = angle_offset_recalc_min;
+		}
+		else if(tmp > angle_offset_recalc)
+		{
+			tmp = angle_offset_recalc;
+		}
+	}
+	angle_offset_recalc_working = tmp;
+}
+
+/*******************************************************************************
+*  FUNCTION NAME: LatenessLog
+*  DESCRIPTION: If enabled (lateness_bucket_time > 0), increment the lateness
+*    histogram bucket which corresponds to the output edge service lateness.
+*    The bucket counters are free-running, the CPU accumulates differences.
+*******************************************************************************/
+void SPARK::LatenessLog(register_a uint24_t lateness)
+{
+	if(lateness_bucket_time > 0)
+	{
+		lateness_hist[Lateness_Bucket(lateness, lateness_bucket_time)]++;
+	}
+}
+
+/*******************************************************************************
+*  FUNCTION NAME: LatenessLogStartAngle
+*  DESCRIPTION: If the start angle being scheduled is already over, the start
+*    edge comes late by more than the service latency. Record it as
+*    LATENESS_IN_PAST now and let the start edge service skip its record.
+*******************************************************************************/
+void SPARK::LatenessLogStartAngle(register_a int24_t start_angle)
+{
+	lateness_in_past = FALSE;
+	if(start_angle - (int24_t)tcr2 < 0)
+	{
+		LatenessLog(LATENESS_IN_PAST);
+		lateness_in_past = TRUE;
+	}
+}
 
 /*******************************************************************************
 *  eTPU Function
@@ -440,6 +569,11 @@ _eTPU_thread SPARK::UPDATE(_eTPU_matches_disabled)
 			ertb = tdc_angle_actual - end_angle;
 			channel.ERWB = ERW_WRITE_ERT_TO_MATCH;
 			break;
+
+		case SPARK_STATE_CRANKING_TOOTH:
+		case SPARK_STATE_CRANKING_END:
+			/* The cranking end timing is kept */
+			break;
 		}
 	}
 }
@@ -451,12 +585,17 @@ _eTPU_thread SPARK::UPDATE(_eTPU_matches_disabled)
 **************************************************************************/
 _eTPU_thread SPARK::RECALC_ANGLE(_eTPU_matches_disabled)
 {
-    if (is_first_recalc)
+    if (recalc_counter == 0)
     {
         /* channel interrupt */
         channel.CIRC = CIRC_INT_FROM_SERVICED;
-        
-        is_first_recalc = FALSE;
+    }
+
+    if ((recalc_counter < recalc_count_max) &&
+        CRANK_Is_Accelerating(recalc_accel_ratio))
+    {
+        /* Schedule an extra RECALC_ANGLE closer to the start angle */
+        recalc_counter++;
         angle_offset_recalc_working >>= 2;
         ScheduleRecalcAngle_NoReturn();
     }
@@ -481,6 +620,13 @@ _eTPU_thread SPARK::RECALC_ANGLE(_eTPU_matches_disabled)
 **************************************************************************/
 _eTPU_thread SPARK::START_ANGLE(_eTPU_matches_disabled)
 {
+	/* Record start edge lateness, unless already recorded as in the past */
+	if(lateness_in_past == FALSE)
+	{
+		LatenessLog(tcr1 - ertb);
+	}
+	lateness_in_past = FALSE;
+
 	/* Store pulse start time */
 	pulse_start_time = ertb;
 	
@@ -508,11 +654,23 @@ _eTPU_thread SPARK::MIN_DWELL_TIME(_eTPU_matches_disabled)
 
 /**************************************************************************
 * THREAD NAME: END_ANGLE
-* DESCRIPTION: Store applied dwell time.
+* DESCRIPTION: In cranking mode, schedule the end time from the reference
+*              tooth.
+*              Store applied dwell time.
 *              Start the multi pulse sequence or schedule next RECAL_ANGLE.
 **************************************************************************/
 _eTPU_thread SPARK::END_ANGLE(_eTPU_matches_disabled)
 {
+	/* Reference tooth at cranking speed? */
+	if(state == SPARK_STATE_CRANKING_TOOTH)
+	{
+		/* Schedule the end time from the captured tooth edge */
+		ScheduleCrankingEndTime_NoReturn();
+	}
+
+	/* Record end edge lateness */
+	LatenessLog(tcr1 - ertb);
+
 	/* Store applied dwell time */
 	dwell_time_applied = ertb - pulse_start_time;
 	
@@ -540,6 +698,9 @@ _eTPU_thread SPARK::END_ANGLE(_eTPU_matches_disabled)
 **************************************************************************/
 _eTPU_thread SPARK::MAX_DWELL_TIME(_eTPU_matches_disabled)
 {
+	/* Record end edge lateness */
+	LatenessLog(tcr1 - erta);
+
 	/* Store applied dwell time */
 	dwell_time_applied = erta - pulse_start_time;
 	
@@ -667,6 +828,9 @@ DEFINE_ENTRY_TABLE(SPARK, SPARK, alternate, outputpin, autocfsr)
 #pragma write h, (::ETPUliteral(#define FS_ETPU_SPARK_TABLE_SELECT) ::ETPUentrytype(SPARK) );
 #pragma write h, (::ETPUliteral(#define FS_ETPU_SPARK_NUM_PARMS) ::ETPUram(SPARK) );
 #pragma write h, ( );
+#pragma write h, (/* Lateness Histogram Definitions, common to SPARK, FUEL and INJ */);
+#pragma write h, (::ETPUliteral(#define FS_ETPU_LATENESS_BUCKET_COUNT) LATENESS_BUCKET_COUNT );
+#pragma write h, ( );
 #pragma write h, (/* Host Service Request Definitions */);
 #pragma write h, (::ETPUliteral(#define FS_ETPU_SPARK_HSR_INIT)        SPARK_HSR_INIT );
 #pragma write h, (::ETPUliteral(#define FS_ETPU_SPARK_HSR_UPDATE)      SPARK_HSR_UPDATE );
@@ -696,6 +860,15 @@ DEFINE_ENTRY_TABLE(SPARK, SPARK, alternate, outputpin, autocfsr)
 #pragma write h, (::ETPUliteral(#define FS_ETPU_SPARK_OFFSET_STATE                     ) ::ETPUlocation (SPARK, state ) );
 #pragma write h, (::ETPUliteral(#define FS_ETPU_SPARK_OFFSET_ERROR                     ) ::ETPUlocation (SPARK, error ) );
 #pragma write h, (::ETPUliteral(#define FS_ETPU_SPARK_OFFSET_GENERATION_DISABLE        ) ::ETPUlocation (SPARK, generation_disable ) );
+#pragma write h, (::ETPUliteral(#define FS_ETPU_SPARK_OFFSET_RECALC_COUNT_MAX         ) ::ETPUlocation (SPARK, recalc_count_max ) );
+#pragma write h, (::ETPUliteral(#define FS_ETPU_SPARK_OFFSET_RECALC_ACCEL_RATIO        ) ::ETPUlocation (SPARK, recalc_accel_ratio ) );
+#pragma write h, (::ETPUliteral(#define FS_ETPU_SPARK_OFFSET_RECALC_LEAD_TIME          ) ::ETPUlocation (SPARK, recalc_lead_time ) );
+#pragma write h, (::ETPUliteral(#define FS_ETPU_SPARK_OFFSET_ANGLE_OFFSET_RECALC_MIN   ) ::ETPUlocation (SPARK, angle_offset_recalc_min ) );
+#pragma write h, (::ETPUliteral(#define FS_ETPU_SPARK_OFFSET_CRANKING_TOOTH_ANGLE      ) ::ETPUlocation (SPARK, cranking_tooth_angle ) );
+#pragma write h, (::ETPUliteral(#define FS_ETPU_SPARK_OFFSET_CRANKING_DELAY            ) ::ETPUlocation (SPARK, cranking_delay ) );
+#pragma write h, (::ETPUliteral(#define FS_ETPU_SPARK_OFFSET_CRANKING_TOOTH_PERIOD     ) ::ETPUlocation (SPARK, cranking_tooth_period ) );
+#pragma write h, (::ETPUliteral(#define FS_ETPU_SPARK_OFFSET_LATENESS_BUCKET_TIME      ) ::ETPUlocation (SPARK, lateness_bucket_time ) );
+#pragma write h, (::ETPUliteral(#define FS_ETPU_SPARK_OFFSET_LATENESS_HIST             ) ::ETPUlocation (SPARK, lateness_hist ) );
 #pragma write h, ( );
 #pragma write h, (/* Error Flags Definitions */);
 #pragma write h, (::ETPUliteral(#define FS_ETPU_SPARK_ERROR_MIN_DWELL_APPLIED)        SPARK_ERROR_MIN_DWELL_APPLIED);
@@ -748,6 +921,24 @@ DEFINE_ENTRY_TABLE(SPARK, SPARK, alternate, outputpin, autocfsr)
 *  REVISION HISTORY:
 *
 *  FILE OWNER: Milan Brejl [r54529]
+*  Revision 1.6  2026/10/18
+*  Output edge lateness histogram added.
+*
+*  Revision 1.5  2026/10/18
+*  Optional time-based recalculation lead (recalc_lead_time), bounded by
+*  angle_offset_recalc_min and angle_offset_recalc.
+*
+*  Revision 1.4  2026/10/18
+*  The count of extra start angle recalculations adapts to the engine
+*  acceleration, up to recalc_count_max.
+*
+*  Revision 1.3  2026/10/18
+*  Start angle conversion precision selected by engine speed.
+*
+*  Revision 1.2  2026/10/18
+*  Cranking mode added - below the cranking_tooth_period speed the spark main
+*  pulse ends cranking_delay after the reference tooth edge.
+*
 *  Revision 1.1  2020/08/14  nxa17216
 *  Added initialization of pin state into an inactive state within INIT thread.
 *  Revision 1.0  2014/03/16  r54529
@@ -35,6 +35,8 @@
 #define SPARK_STATE_MIN_DWELL           2
 #define SPARK_STATE_MAX_DWELL           3
 #define SPARK_STATE_MULTI_PULSE         4
+#define SPARK_STATE_CRANKING_TOOTH      5
+#define SPARK_STATE_CRANKING_END        6
 
 /* Error Flags */
 #define SPARK_ERROR_MIN_DWELL_APPLIED   0x01
@@ -82,7 +84,17 @@ public:
         uint8_t  error; 
   const uint8_t  generation_disable; 
          int24_t angle_offset_recalc_working;
-         _Bool   is_first_recalc;
+        uint8_t  recalc_counter;
+  const uint8_t  recalc_count_max;
+  const ufract24_t recalc_accel_ratio;
+  const uint24_t recalc_lead_time;
+  const  int24_t angle_offset_recalc_min;
+  const  int24_t cranking_tooth_angle;
+  const uint24_t cranking_delay;
+  const uint24_t cranking_tooth_period;
+  const uint24_t lateness_bucket_time;
+        uint24_t lateness_hist[LATENESS_BUCKET_COUNT];
+        _Bool    lateness_in_past;
 
 
     /************************************/
@@ -108,8 +120,12 @@ public:
     _eTPU_fragment ScheduleStartAngle_NoReturn(void);
     _eTPU_fragment ScheduleMinDwellTime_NoReturn(void);
     _eTPU_fragment ScheduleEndAngleAndMaxDwellTime_NoReturn(void);
+    _eTPU_fragment ScheduleCrankingEndTime_NoReturn(void);
     _eTPU_fragment ScheduleMultiPulse_NoReturn(void);
     void ReadSparkParams(void);
+    void SetRecalcOffset(void);
+    void LatenessLog(register_a uint24_t lateness);
+    void LatenessLogStartAngle(register_a int24_t start_angle);
     
     
     /************************************/
@@ -155,6 +171,18 @@ public:
 *  REVISION HISTORY:
 *
 *  FILE OWNER: Milan Brejl [r54529]
+*  Revision 1.4  2026/10/18
+*  Output edge lateness histogram parameters added.
+*
+*  Revision 1.3  2026/10/18
+*  Time-based recalculation lead parameters added.
+*
+*  Revision 1.2  2026/10/18
+*  Acceleration-adaptive count of start angle recalculations.
+*
+*  Revision 1.1  2026/10/18
+*  Cranking mode parameters and states added.
+*
 *  Revision 1.0  2014/03/06  r54529
 *  Minor comment and formating improvements. MISRA compliancy check.
 *  Ready for eTPU Engine Control Library release 1.0.